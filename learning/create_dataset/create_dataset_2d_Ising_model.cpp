@@ -3,37 +3,27 @@
 #include <fstream>
 #include <string>
 #include <algorithm>
-const long int monte_carlo_step = 100000;
+#include <type_traits>
+#include "../../monte_carlo_simulation/engine/spin_engine.hpp"
+#include "../../monte_carlo_simulation/engine/statistics.hpp"
+#include "../../monte_carlo_simulation/engine/multispin.hpp"
+const long int monte_carlo_step = 100000; // number of sweeps
 const int L = 64;
 const int nx = L; // number of sites along x-direction
 const int ny = L; // number of sites along y-direction
-const int niter = monte_carlo_step * nx * ny;
 const double coupling_J = 1.0;
 const int nconf = 30;
 const int ndata = 1000;
 const double t_start = 2.1;
-const int nskip = nx * ny * 100; // Frequency of measurement
+const int ntherm = 1000; // cap on burn-in sweeps; it ends earlier once the energy is stationary
+const int nskip = 100;   // Frequency of measurement (sweeps)
+const int nskip_therm = 4; // sweeps between the energies of the burn-in test, an O(N) scan of replica 0
 const int nconfig = 0;
+const bool multispin = true; // true -> 64 replicas per sweep (multi-spin coding); false -> one lattice
+const std::uint64_t seed = 0; // 0 -> fresh seed (recorded in seed_log.txt); otherwise rerun that seed
 
-double calc_action_change(const int spin[nx][ny], const double coupling_J, const double temperature, const int ix, const int iy)
-{
-    double action_change = 0.0;
-    // double sum_change=0;
-
-    int ixp1 = (ix + 1) % nx;      // ixp1=ix+1; be careful about the boundary condition.
-    int iyp1 = (iy + 1) % ny;      // iyp1=iy+1; be careful about the boundary condition.
-    int ixm1 = (ix - 1 + nx) % nx; // ixm1=ix-1; be careful about the boundary condition.
-    int iym1 = (iy - 1 + ny) % ny; // iym1=iy-1; be careful about the boundary condition.
-
-    double sum_change = 2 * spin[ix][iy] * spin[ixp1][iy] +
-                        2 * spin[ix][iy] * spin[ix][iyp1] +
-                        2 * spin[ix][iy] * spin[ixm1][iy] +
-                        2 * spin[ix][iy] * spin[ix][iym1];
-
-    action_change = sum_change * coupling_J / temperature;
-
-    return action_change;
-}
+using Lattice = std::conditional_t<multispin, mcmc::MultiSpinIsing<L>, mcmc::SquareLattice<mcmc::Ising, L>>;
+using Update = std::conditional_t<multispin, mcmc::MultiSpinMetropolis<L>, mcmc::Metropolis<Lattice>>;
 
 int main()
 {
@@ -45,62 +35,43 @@ int main()
         sum += 0.01;
         std::cout << temperature[i] << std::endl;
     }
+    const std::uint64_t run_seed = mcmc::make_seed(seed);
+    std::cout << "seed " << run_seed << std::endl;
     for (int conf = 0; conf < nconf + 1; conf++)
     {
         double T = temperature[conf];
         int data_num = 0;
-        int spin[nx][ny];
-        srand((unsigned)time(NULL));
+        Lattice spin;
+        mcmc::Xoshiro256ss rng(run_seed, conf); // one stream per temperature
+        mcmc::Equilibration equilibration(ntherm, nskip_therm); // MSER test on the energy
         // 初期化
-        if (nconfig == 0)
+        mcmc::init_config(spin, nconfig, "input/2d_Ising_output_config.txt");
+        // 各温度でのモンテカルロシミュレーション
+        Update metropolis(coupling_J, 0e0, T);
+        for (long int iter = 0; iter != monte_carlo_step; iter++)
         {
-            std::ifstream inputconfig("input/2d_Ising_output_config.txt");
-            if (!inputconfig)
+            metropolis.sweep(spin, rng);
+            if (!equilibration.equilibrated())
             {
-                std::cout << "inputfile not found" << std::endl;
-                exit(1);
-            }
-            for (int ix = 0; ix != nx; ix++)
-            {
-                for (int iy = 0; iy != ny; iy++)
+                if (equilibration.tick() && equilibration.add(mcmc::calc_energy(mcmc::replica(spin, 0), coupling_J)))
                 {
-                    inputconfig >> ix >> iy >> spin[ix][iy];
+                    std::cout << T << "   burn-in " << equilibration.burn_in() << " (E every " << nskip_therm << ")" << std::endl;
                 }
             }
-            inputconfig.close();
-        }
-        // 各温度でのモンテカルロシミュレーション
-        for (long int iter = 0; iter != niter; iter++)
-        {
-            double rand_site = (double)rand() / RAND_MAX;
-            rand_site = rand_site * nx * ny;
-            int ix = (int)rand_site / ny;
-            int iy = (int)rand_site % ny;
-            double metropolis = (double)rand() / RAND_MAX;
-            double action_change = calc_action_change(spin, coupling_J, T, ix, iy);
-            if (exp(-action_change) > metropolis)
+            else if ((iter + 1) % nskip == 0)
             {
-                // accept
-                spin[ix][iy] = -spin[ix][iy]; // flip
-            }
-            else
-            {
-                // reject
-            }
-            if (iter > 1000 * nx * ny && (iter + 1) % nskip == 0 && data_num < ndata)
-            {
-                std::ofstream outputfile("../txtfile/2d_Ising/L" + std::to_string(L) + "T" + std::to_string(conf) + "_" + std::to_string(data_num+ndata) + ".txt");
-                for (int ix = 0; ix != nx; ix++)
+                for (int r = 0; r != mcmc::replica_count<Lattice>::value && data_num < ndata; r++)
+                {
+                    const std::string filename = "../txtfile/2d_Ising/L" + std::to_string(L) + "T" + std::to_string(conf) + "_" + std::to_string(data_num + ndata) + ".bin";
+                    mcmc::write_config(filename, mcmc::replica(spin, r), {T, rng.seed(), rng.stream(), iter + 1});
+                    data_num++;
+                }
+                if (data_num == ndata)
                 {
-                    for (int iy = 0; iy != ny; iy++)
-                    {
-                        outputfile << ix << ' ' << iy << ' ' << spin[ix][iy] << ' ' << std::endl;
-                    }
+                    break;
                 }
-                outputfile.close();
-                data_num++;
             }
         }
     }
     return 0;
-}
\ No newline at end of file
+}
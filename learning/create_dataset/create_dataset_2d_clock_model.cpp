@@ -3,46 +3,32 @@
 #include <fstream>
 #include <string>
 #include <algorithm>
-const double pi = 3.141592653589793;
-const long int monte_carlo_step = 100000;
+#include <type_traits>
+#include "../../monte_carlo_simulation/engine/spin_engine.hpp"
+#include "../../monte_carlo_simulation/engine/statistics.hpp"
+#include "../../monte_carlo_simulation/engine/checkerboard.hpp"
+const long int monte_carlo_step = 100000; // number of cluster steps or sweeps
 const int L = 64;
 const int nx = L; // number of sites along x-direction
 const int ny = L; // number of sites along y-direction
-const int niter = monte_carlo_step * nx * ny;
+const double coupling_J = 1.0;
 // const int Q = 4;
 const int Q = 6;
-const double coupling_J = 1.0;
 // const int nconf = 50;
 const int nconf = 80;
 const int ndata = 1000;
 // const double t_start = 0.9;
 const double t_start = 0.4;
-const int nskip = nx * ny * 100; // Frequency of measurement
+const bool wolff = true;            // true -> Wolff reflection-cluster steps; false -> Metropolis sweeps
+const int ntherm = 1000;            // cap on burn-in (cluster steps or sweeps); it ends earlier once the energy is stationary
+const int nskip_therm = 4;          // cluster steps or sweeps between the energies of the burn-in test, an O(N) scan
+const int nskip = wolff ? 20 : 100; // Frequency of measurement (cluster steps or sweeps)
 const int nconfig = 0;
+const bool checkerboard = true; // true -> checkerboard sweeps; false -> random-site updates
+const std::uint64_t seed = 0; // 0 -> fresh seed (recorded in seed_log.txt); otherwise rerun that seed
 
-double calc_action_change(const int spin[nx][ny], const int next_spin, const double coupling_J, const double temperature, const int ix, const int iy)
-{
-    double action_change = 0e0;
-    // double sum_change=0;
-
-    int ixp1 = (ix + 1) % nx;      // ixp1=ix+1;
-    int iyp1 = (iy + 1) % ny;      // iyp1=iy+1;
-    int ixm1 = (ix - 1 + nx) % nx; // ixm1=ix-1;
-    int iym1 = (iy - 1 + ny) % ny; // iym1=iy-1;
-
-    double sum_change = std::cos(2 * pi * spin[ix][iy] / Q - 2 * pi * spin[ixp1][iy] / Q) +
-                        std::cos(2 * pi * spin[ix][iy] / Q - 2 * pi * spin[ix][iyp1] / Q) +
-                        std::cos(2 * pi * spin[ix][iy] / Q - 2 * pi * spin[ixm1][iy] / Q) +
-                        std::cos(2 * pi * spin[ix][iy] / Q - 2 * pi * spin[ix][iym1] / Q) -
-                        std::cos(2 * pi * next_spin / Q - 2 * pi * spin[ixp1][iy] / Q) -
-                        std::cos(2 * pi * next_spin / Q - 2 * pi * spin[ix][iyp1] / Q) -
-                        std::cos(2 * pi * next_spin / Q - 2 * pi * spin[ixm1][iy] / Q) -
-                        std::cos(2 * pi * next_spin / Q - 2 * pi * spin[ix][iym1] / Q);
-
-    action_change = sum_change * coupling_J / temperature;
-
-    return action_change;
-}
+using Lattice = mcmc::SquareLattice<mcmc::Clock<Q>, L>;
+using Update = std::conditional_t<checkerboard, mcmc::QStateCheckerboardMetropolis<Lattice>, mcmc::Metropolis<Lattice>>;
 
 int main()
 {
@@ -54,64 +40,44 @@ int main()
         sum += 0.01;
         std::cout << temperature[i] << std::endl;
     }
+    const std::uint64_t run_seed = mcmc::make_seed(seed);
+    std::cout << "seed " << run_seed << std::endl;
     for (int conf = 0; conf < nconf + 1; conf++)
     {
         double T = temperature[conf];
         int data_num = 0;
-        int spin[nx][ny];
-        srand((unsigned)time(NULL));
+        Lattice spin;
+        mcmc::Xoshiro256ss rng(run_seed, conf); // one stream per temperature
+        mcmc::Equilibration equilibration(ntherm, nskip_therm); // MSER test on the energy
         // 初期化
-        if (nconfig == 0)
-        {
-            std::ifstream inputconfig("input/2d_Clock_q=" + std::to_string(Q) + "_output_config.txt");
-            if (!inputconfig)
-            {
-                std::cout << "inputfile not found" << std::endl;
-                exit(1);
-            }
-            for (int ix = 0; ix != nx; ix++)
-            {
-                for (int iy = 0; iy != ny; iy++)
-                {
-                    inputconfig >> ix >> iy >> spin[ix][iy];
-                }
-            }
-            inputconfig.close();
-        }
+        mcmc::init_config(spin, nconfig, "input/2d_Clock_q=" + std::to_string(Q) + "_output_config.txt");
         // 各温度でモンテカルロシミュレーション
-        for (long int iter = 0; iter != niter; iter++)
+        Update metropolis(coupling_J, 0e0, T);
+        mcmc::ReflectionWolff<Lattice> cluster(coupling_J, T);
+        for (long int iter = 0; iter != monte_carlo_step; iter++)
         {
-            double rand_site = (double)rand() / RAND_MAX;
-            rand_site = rand_site * nx * ny;
-            int ix = (int)rand_site / ny;
-            int iy = (int)rand_site % ny;
-            double metropolis = (double)rand() / RAND_MAX;
-            int next_spin = rand() % Q;
-            double action_change = calc_action_change(spin, next_spin, coupling_J, T, ix, iy);
-            if (exp(-action_change) > metropolis)
+            if (wolff)
             {
-                // accept
-                spin[ix][iy] = next_spin; // flip
+                cluster.step(spin, rng);
             }
             else
             {
-                // reject
+                metropolis.sweep(spin, rng);
             }
-
-            if (iter > 1000 * nx * ny && (iter + 1) % nskip == 0 && data_num < ndata)
+            if (!equilibration.equilibrated())
             {
-                std::ofstream outputfile("../txtfile/2d_Clock/q=" + std::to_string(Q) + "/L" + std::to_string(L) + "T" + std::to_string(conf) + "_" + std::to_string(data_num + ndata) + ".txt");
-                for (int ix = 0; ix != nx; ix++)
+                if (equilibration.tick() && equilibration.add(mcmc::calc_energy(spin, coupling_J)))
                 {
-                    for (int iy = 0; iy != ny; iy++)
-                    {
-                        outputfile << ix << ' ' << iy << ' ' << spin[ix][iy] << ' ' << std::endl;
-                    }
+                    std::cout << T << "   burn-in " << equilibration.burn_in() << " (E every " << nskip_therm << ")" << std::endl;
                 }
-                outputfile.close();
+            }
+            else if ((iter + 1) % nskip == 0 && data_num < ndata)
+            {
+                const std::string filename = "../txtfile/2d_Clock/q=" + std::to_string(Q) + "/L" + std::to_string(L) + "T" + std::to_string(conf) + "_" + std::to_string(data_num + ndata) + ".bin";
+                mcmc::write_config(filename, spin, {T, rng.seed(), rng.stream(), iter + 1});
                 data_num++;
             }
         }
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -3,55 +3,25 @@
 #include <fstream>
 #include <string>
 #include <algorithm>
-const long int monte_carlo_step = 100000;
+#include "../../monte_carlo_simulation/engine/spin_engine.hpp"
+#include "../../monte_carlo_simulation/engine/statistics.hpp"
+const long int monte_carlo_step = 100000; // number of sweeps
 const int L = 64;
 const int nx = L; // number of sites along x-direction
 const int ny = L; // number of sites along y-direction
-const int niter = monte_carlo_step * nx * ny;
+const double coupling_J = 1.0;
 // const int Q = 3;
 const int Q = 5;
-const double coupling_J = 1.0;
 const int nconf = 30;
 const int ndata = 1000;
 // const double t_start = 0.85;
 const double t_start = 0.7;
-const int nskip = nx * ny * 100; // Frequency of measurement
+const int ntherm = 1000; // cap on burn-in sweeps; it ends earlier once the energy is stationary
+const int nskip = 100;   // Frequency of measurement (sweeps)
 const int nconfig = 0;
+const std::uint64_t seed = 0; // 0 -> fresh seed (recorded in seed_log.txt); otherwise rerun that seed
 
-double kronecker_delta(const int spin_1, const int spin_2)
-{
-    if (spin_1 == spin_2)
-    {
-        return 1;
-    }
-    else
-    {
-        return 0;
-    }
-}
-
-double calc_action_change(const int spin[nx][ny], const int next_spin, const double coupling_J, const double temperature, const int ix, const int iy)
-{
-    double action_change = 0e0;
-    // double sum_change=0;
-
-    int ixp1 = (ix + 1) % nx;      // ixp1=ix+1; be careful about the boundary condition.
-    int iyp1 = (iy + 1) % ny;      // iyp1=iy+1; be careful about the boundary condition.
-    int ixm1 = (ix - 1 + nx) % nx; // ixm1=ix-1; be careful about the boundary condition.
-    int iym1 = (iy - 1 + ny) % ny; // iym1=iy-1; be careful about the boundary condition.
-
-    double sum_change = kronecker_delta(spin[ix][iy], spin[ixp1][iy]) +
-                        kronecker_delta(spin[ix][iy], spin[ix][iyp1]) +
-                        kronecker_delta(spin[ix][iy], spin[ixm1][iy]) +
-                        kronecker_delta(spin[ix][iy], spin[ix][iym1]) -
-                        kronecker_delta(next_spin, spin[ixp1][iy]) -
-                        kronecker_delta(next_spin, spin[ix][iyp1]) -
-                        kronecker_delta(next_spin, spin[ixm1][iy]) -
-                        kronecker_delta(next_spin, spin[ix][iym1]);
-    action_change = sum_change * coupling_J / temperature;
-
-    return action_change;
-}
+using Lattice = mcmc::SquareLattice<mcmc::Potts<Q>, L>;
 
 int main()
 {
@@ -63,64 +33,37 @@ int main()
         sum += 0.01;
         std::cout << temperature[i] << std::endl;
     }
+    const std::uint64_t run_seed = mcmc::make_seed(seed);
+    std::cout << "seed " << run_seed << std::endl;
     for (int conf = 0; conf < nconf + 1; conf++)
     {
         double T = temperature[conf];
         int data_num = 0;
-        int spin[nx][ny];
-        srand((unsigned)time(NULL));
+        Lattice spin;
+        mcmc::Xoshiro256ss rng(run_seed, conf); // one stream per temperature
+        mcmc::Equilibration equilibration(ntherm); // MSER test on the energy
         // 初期化
-        if (nconfig == 0)
+        mcmc::init_config(spin, nconfig, "input/2d_Potts_q=" + std::to_string(Q) + "_output_config.txt");
+        mcmc::RunningTotals<Lattice::Model> totals(spin); // follows every accepted move
+        // 各温度でモンテカルロシミュレーション
+        mcmc::Metropolis<Lattice> metropolis(coupling_J, 0e0, T);
+        for (long int iter = 0; iter != monte_carlo_step; iter++)
         {
-            std::ifstream inputconfig("input/2d_Potts_q=" + std::to_string(Q) + "_output_config.txt");
-            if (!inputconfig)
-            {
-                std::cout << "inputfile not found" << std::endl;
-                exit(1);
-            }
-            for (int ix = 0; ix != nx; ix++)
+            metropolis.sweep(spin, rng, &totals);
+            if (!equilibration.equilibrated())
             {
-                for (int iy = 0; iy != ny; iy++)
+                if (equilibration.add(totals.energy(coupling_J)))
                 {
-                    inputconfig >> ix >> iy >> spin[ix][iy];
+                    std::cout << T << "   burn-in " << equilibration.burn_in() << std::endl;
                 }
             }
-            inputconfig.close();
-        }
-        // 各温度でモンテカルロシミュレーション
-        for (long int iter = 0; iter != niter; iter++)
-        {
-            double rand_site = (double)rand() / RAND_MAX;
-            rand_site = rand_site * nx * ny;
-            int ix = (int)rand_site / ny;
-            int iy = (int)rand_site % ny;
-            double metropolis = (double)rand() / RAND_MAX;
-            int next_spin = rand() % Q;
-            double action_change = calc_action_change(spin, next_spin, coupling_J, T, ix, iy);
-            if (exp(-action_change) > metropolis)
-            {
-                // accept
-                spin[ix][iy] = next_spin; // flip
-            }
-            else
-            {
-                // reject
-            }
-
-            if (iter > 1000 * nx * ny && (iter + 1) % nskip == 0 && data_num < ndata)
+            else if ((iter + 1) % nskip == 0 && data_num < ndata)
             {
-                std::ofstream outputfile("../txtfile/2d_Potts/q=" + std::to_string(Q) + "/L" + std::to_string(L) + "T" + std::to_string(conf) + "_" + std::to_string(data_num) + ".txt");
-                for (int ix = 0; ix != nx; ix++)
-                {
-                    for (int iy = 0; iy != ny; iy++)
-                    {
-                        outputfile << ix << ' ' << iy << ' ' << spin[ix][iy] << ' ' << std::endl;
-                    }
-                }
-                outputfile.close();
+                const std::string filename = "../txtfile/2d_Potts/q=" + std::to_string(Q) + "/L" + std::to_string(L) + "T" + std::to_string(conf) + "_" + std::to_string(data_num) + ".bin";
+                mcmc::write_config(filename, spin, {T, rng.seed(), rng.stream(), iter + 1});
                 data_num++;
             }
         }
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -5,22 +5,43 @@ from tqdm import tqdm
 from multiprocessing import Pool
 
 
+# 64-byte header of the binary configurations (monte_carlo_simulation/engine/config_io.hpp)
+HEADER = np.dtype([('magic', 'S8'), ('version', '<u4'), ('nbit', '<u4'), ('q', '<u4'),
+                   ('nx', '<u4'), ('ny', '<u4'), ('stream', '<i4'), ('model', 'S8'),
+                   ('temperature', '<f8'), ('seed', '<u8'), ('sweep', '<i8')])
+
+
+def read_binary(path_name):
+    raw = np.fromfile(path_name, dtype=np.uint8)
+    header = raw[:HEADER.itemsize].view(HEADER)[0]
+    nbit = int(header['nbit'])
+    nx, ny = int(header['nx']), int(header['ny'])
+    words = raw[HEADER.itemsize:].view('<u8')
+    shift = np.arange(64 // nbit, dtype=np.uint64) * np.uint64(nbit)
+    state = ((words[:, None] >> shift) & np.uint64((1 << nbit) - 1)).reshape(-1)[:nx * ny]
+    state = state.astype(np.float64).reshape(nx, ny)
+    # spin values as in the text dumps: Ising state 0 -> +1, 1 -> -1
+    return 1 - 2 * state if header['model'] == b'Ising' else state
+
+
 def txt2npy(inputs):
     t, i, L, model_name, Q = inputs
     if Q == None:
-        import_path_name = f'txtfile/{model_name}/L{L}T{t}_{i}.txt'
+        import_path_name = f'txtfile/{model_name}/L{L}T{t}_{i}'
         export_path_name = f'dataset/{model_name}/L{L}/L{L}T{t}_{i}.npy'
     else:
-        import_path_name = f'txtfile/{model_name}/q={Q}/L{L}T{t}_{i}.txt'
+        import_path_name = f'txtfile/{model_name}/q={Q}/L{L}T{t}_{i}'
         export_path_name = f'dataset/{model_name}/L{L}_q={Q}/L{L}T{t}_{i}.npy'
-    if (os.path.exists(import_path_name)):
+    if (os.path.exists(import_path_name + '.bin')):
+        np.save(export_path_name, read_binary(import_path_name + '.bin'))
+    elif (os.path.exists(import_path_name + '.txt')):
         spin = np.empty((L, L))
-        for read in open(import_path_name).readlines():
+        for read in open(import_path_name + '.txt').readlines():
             read = read[:-2].split(' ')
             ix = int(read[0])
             iy = int(read[1])
             spin[ix, iy] = read[2]
-            np.save(export_path_name, spin)
+        np.save(export_path_name, spin)
     else:
         print('no input configuration')
         sys.exit()
@@ -1,191 +1,48 @@
 #include <iostream>
 #include <cmath>
 #include <fstream>
+#include <string>
+#include <type_traits>
+#include "engine/spin_engine.hpp"
+#include "engine/checkerboard.hpp"
 const int monte_carlo_step = 100000;
 const int L = 64;
 const int nx = L; // number of sites along x-direction
 const int ny = L; // number of sites along y-direction
-const long int niter = nx * ny * monte_carlo_step;
 const double coupling_J = 1.0;
 const double coupling_h = 0;
 const double temperature = 3.8;
-const int nskip = nx * ny; // Frequency of measurement
+const int nskip = 1;       // Frequency of measurement (sweeps)
 const int nconfig = 0;           // 0 -> read 'input_config.txt'; 1 -> all up; -1 -> all down
-/*********************************/
-/*** Calculation of the action ***/
-/*********************************/
-double calc_action(const int spin[nx][ny], const double coupling_J, const double coupling_h, const double temperature)
-{
-    double action = 0.0;
-    int sum1 = 0;
-    int sum2 = 0;
-    for (int ix = 0; ix != nx; ix++)
-    {
-        int ixp1 = (ix + 1) % nx; // ixp1=ix+1; be careful about the boundary condition.
-        for (int iy = 0; iy != ny; iy++)
-        {
-            int iyp1 = (iy + 1) % ny; // iyp1=iy+1; be careful about the boundary condition.
-            sum1 = sum1 + spin[ix][iy];
-            sum2 = sum2 + spin[ix][iy] * spin[ixp1][iy] + spin[ix][iy] * spin[ix][iyp1];
-        }
-    }
-    action = (sum2 * coupling_J + sum1 * coupling_h) / temperature * (-1e0);
-
-    return action;
-}
-/***********************************************/
-/*** Calculation of the change of the action ***/
-/***  when the spin at (ix,iy) is flipped    ***/
-/***********************************************/
-double calc_action_change(const int spin[nx][ny], const double coupling_J, const double coupling_h, const double temperature, const int ix, const int iy)
-{
-    double action_change = 0e0;
-    // int sum1_change=0;
-    // int sum2_change=0;
-
-    int ixp1 = (ix + 1) % nx;      // ixp1=ix+1; be careful about the boundary condition.
-    int iyp1 = (iy + 1) % ny;      // iyp1=iy+1; be careful about the boundary condition.
-    int ixm1 = (ix - 1 + nx) % nx; // ixm1=ix-1; be careful about the boundary condition.
-    int iym1 = (iy - 1 + ny) % ny; // iym1=iy-1; be careful about the boundary condition.
+const bool checkerboard = true;  // true -> checkerboard sweeps; false -> random-site updates
+const std::uint64_t seed = 0; // 0 -> fresh seed (recorded in seed_log.txt); otherwise rerun that seed
 
-    int sum1_change = 2 * spin[ix][iy];
-    int sum2_change = 2 * spin[ix][iy] * spin[ixp1][iy] + 2 * spin[ix][iy] * spin[ix][iyp1] + 2 * spin[ix][iy] * spin[ixm1][iy] + 2 * spin[ix][iy] * spin[ix][iym1];
-
-    action_change = (sum2_change * coupling_J + sum1_change * coupling_h) / temperature;
-
-    return action_change;
-}
-/*************************************/
-/*** Calculation of the total spin ***/
-/*************************************/
-int calc_total_spin(const int spin[nx][ny])
-{
-    int total_spin = 0;
-    for (int ix = 0; ix != nx; ix++)
-    {
-        for (int iy = 0; iy != ny; iy++)
-        {
-            total_spin = total_spin + spin[ix][iy];
-        }
-    }
-    return total_spin;
-}
-
-int calc_total_plus_spin(const int spin[nx][ny])
-{
-    int total_spin = 0;
-    for (int ix = 0; ix != nx; ix++)
-    {
-        for (int iy = 0; iy != ny; iy++)
-        {
-            if (spin[ix][iy] == 1)
-            {
-                total_spin = total_spin + 1;
-            }
-        }
-    }
-    return total_spin;
-}
+using Lattice = std::conditional_t<checkerboard, mcmc::CheckerboardIsing<L>, mcmc::SquareLattice<mcmc::Ising, L>>;
+using Update = std::conditional_t<checkerboard, mcmc::CheckerboardMetropolis<L>, mcmc::Metropolis<Lattice>>;
 
 int main()
 {
-    int spin[nx][ny];
+    Lattice spin;
     int count = 0;
-    srand((unsigned)time(NULL));
+    mcmc::Xoshiro256ss rng(mcmc::make_seed(seed));
+    std::cout << "seed " << rng.seed() << std::endl;
     /*********************************/
     /********* 初期状態の決定 ********/
     /*********************************/
-    if (nconfig == 1)
-    {
-        for (int ix = 0; ix != nx; ix++)
-        {
-            for (int iy = 0; iy != ny; iy++)
-            {
-                spin[ix][iy] = 1;
-            }
-        }
-    }
-    if (nconfig == -1)
-    {
-        for (int ix = 0; ix != nx; ix++)
-        {
-            for (int iy = 0; iy != ny; iy++)
-            {
-                spin[ix][iy] = -1;
-            }
-        }
-    }
-    if (nconfig == 0)
-    {
-        std::ifstream inputconfig("output/2d_Ising_output_config.txt");
-        if (!inputconfig)
-        {
-            std::cout << "inputfile not found" << std::endl;
-            exit(1);
-        }
-        for (int ix = 0; ix != nx; ix++)
-        {
-            for (int iy = 0; iy != ny; iy++)
-            {
-                inputconfig >> ix >> iy >> spin[ix][iy];
-            }
-        }
-        inputconfig.close();
-    }
-    // std::ofstream outputfile("output/2d_Ising_Metropolis_output_t2.5.txt");
+    mcmc::init_config(spin, nconfig, "output/2d_Ising_output_config.txt");
 
-    for (long int iter = 0; iter != niter; iter++)
+    Update metropolis(coupling_J, coupling_h, temperature);
+    for (long int iter = 0; iter != monte_carlo_step; iter++)
     {
-        double rand_site = (double)rand() / RAND_MAX;
-        rand_site = rand_site * nx * ny;
-        int ix = (int)rand_site / ny;
-        int iy = (int)rand_site % ny;
-        double metropolis = (double)rand() / RAND_MAX;
-        double action_change = calc_action_change(spin, coupling_J, coupling_h, temperature, ix, iy);
-        if (exp(-action_change) > metropolis)
-        {
-            // accept
-            spin[ix][iy] = -spin[ix][iy]; // flip
-        }
-        else
-        {
-            // reject
-        }
-        // int total_spin = calc_total_spin(spin);
-        // int total_plus_spin = calc_total_plus_spin(spin);
-        // double energy = calc_action(spin, coupling_J, coupling_h, temperature) * temperature;
+        metropolis.sweep(spin, rng);
 
         if ((iter + 1) % nskip == 0)
         {
-            std::ofstream outputconfig("output/fig_t38/2d_Ising_Metropolis_output_config_" + std::to_string(count) + ".txt");
-            for (int ix = 0; ix != nx; ix++)
-            {
-                for (int iy = 0; iy != ny; iy++)
-                {
-                    outputconfig << ix << ' ' << iy << ' ' << spin[ix][iy] << ' ' << std::endl;
-                }
-            }
+            // binary snapshot; the header records T, seed, stream and sweep (name it .txt for the text format)
+            const std::string filename = "output/fig_t38/2d_Ising_Metropolis_output_config_" + std::to_string(count) + ".bin";
+            mcmc::write_config(filename, spin, {temperature, rng.seed(), rng.stream(), iter + 1});
             count++;
-            outputconfig.close();
         }
-
-        // if ((iter + 1) % nskip == 0)
-        // {
-        //     std::cout << std::fixed << std::setprecision(4)
-        //               << count * nskip << "   "
-        //               << total_spin << "   "
-        //               << total_plus_spin << "   "
-        //               << energy << "   "
-        //               << std::endl;
-        //     outputfile << std::fixed << std::setprecision(4)
-        //                << count * nskip << "   "
-        //                << total_spin << "   "
-        //                << total_plus_spin << "   "
-        //                << energy << "   "
-        //                << std::endl;
-        //     count++;
-        // }
     }
-    // outputfile.close();
     return 0;
-}
\ No newline at end of file
+}
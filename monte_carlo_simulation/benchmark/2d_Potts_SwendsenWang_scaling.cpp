@@ -0,0 +1,65 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <chrono>
+#include "../engine/spin_engine.hpp"
+#include "../engine/parallel.hpp"
+// g++ -std=c++17 -O3 -march=native -fopenmp 2d_Potts_SwendsenWang_scaling.cpp
+const int L = 2048;
+const int Q = 2;
+const double coupling_J = 1.0;
+const double temperature = coupling_J / std::log(1e0 + std::sqrt((double)Q)); // T_c
+const int ntherm = 20; // updates before timing
+const int nstep = 50;  // timed updates
+const std::uint64_t seed = 0; // 0 -> fresh seed; otherwise rerun that seed
+
+using Lattice = mcmc::SquareLattice<mcmc::Potts<Q>, L, mcmc::ModuloLayout, mcmc::ByteStorage>;
+
+// seconds per update, measured after ntherm updates from an ordered start
+template <class Update>
+double time_per_step(Update &update, const std::uint64_t run_seed)
+{
+    Lattice spin;
+    spin.fill(0);
+    mcmc::Xoshiro256ss rng(run_seed);
+    for (int iter = 0; iter != ntherm; iter++)
+    {
+        update.step(spin, rng);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (int iter = 0; iter != nstep; iter++)
+    {
+        update.step(spin, rng);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / nstep;
+}
+
+int main()
+{
+    const std::uint64_t run_seed = mcmc::make_seed(seed);
+    std::cout << "seed " << run_seed << std::endl;
+    std::cout << "L = " << L << ", Q = " << Q << ", T = " << temperature << std::endl;
+
+    mcmc::SwendsenWang<Lattice> serial(coupling_J, temperature);
+    const double serial_time = time_per_step(serial, run_seed);
+    std::cout << std::fixed << std::setprecision(2)
+              << "serial        " << serial_time * 1e9 / Lattice::nsite << " ns/site" << std::endl;
+
+    int max_threads = 1;
+#ifdef _OPENMP
+    max_threads = omp_get_max_threads();
+#endif
+    for (int nthread = 1; nthread <= max_threads; nthread *= 2)
+    {
+#ifdef _OPENMP
+        omp_set_num_threads(nthread);
+#endif
+        mcmc::ParallelSwendsenWang<Lattice> parallel(coupling_J, temperature);
+        const double parallel_time = time_per_step(parallel, run_seed);
+        std::cout << std::fixed << std::setprecision(2)
+                  << "threads " << std::setw(4) << parallel.get_num_threads() << "  "
+                  << parallel_time * 1e9 / Lattice::nsite << " ns/site   speedup "
+                  << serial_time / parallel_time << std::endl;
+    }
+    return 0;
+}
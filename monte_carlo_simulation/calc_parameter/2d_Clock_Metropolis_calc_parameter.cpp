@@ -1,110 +1,78 @@
 #include <iostream>
+#include <iomanip>
 #include <cmath>
 #include <fstream>
 #include <string>
 #include <algorithm>
-const double pi = 3.141592653589793;
-const long int niter = 100000;
+#include <deque>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "../engine/spin_engine.hpp"
+#include "../engine/checkerboard.hpp"
+#include "../engine/parallel.hpp"
+#include "../engine/schedule.hpp"
+#include "../engine/statistics.hpp"
+#include "../engine/checkpoint.hpp"
+const long int niter = 100000; // cap on sweeps per temperature
 const int L = 64;
 const int nx = L; // number of sites along x-direction
 const int ny = L; // number of sites along y-direction
-const int monte_carlo_step = niter * nx * ny;
 const int Q = 4;
 const double coupling_J = 1.0;
 const int nconf = 80;
 const double t_start = 1.8;
-const int nskip = nx * ny * 10; // Frequency of measurement
+const double t_critical = 1.13; // runs near here are started first (Q=4: 1.13, Q=6: about 0.9)
+const int ntherm = 1000; // cap on burn-in sweeps; it ends earlier once the energy is stationary
+const int nskip_therm = 4; // sweeps (or cluster steps) between the energies of the burn-in test; calc_energy costs about half a checkerboard sweep
+const double target_error = 0.01; // relative error on the Binder ratio at which a temperature stops
 const int nconfig = 1;
+const bool checkerboard = true; // true -> checkerboard sweeps; false -> random-site updates
+const bool parallel = false;    // true -> OpenMP strips of each checkerboard sweep, temperatures one after another (build with -fopenmp)
+const bool wolff = false;       // true -> Wolff reflection-cluster steps instead of sweeps (niter, ntherm and the stride count steps)
+const std::uint64_t seed = 0; // 0 -> fresh seed (recorded in seed_log.txt); otherwise rerun that seed
+const long int checkpoint_every = 1000;   // sweeps (or cluster steps) between snapshots of a temperature
+const double checkpoint_interval = 600e0; // seconds between checkpoint writes; rerun with --resume after an interruption
 
-double calc_energy(const int spin[nx][ny], const double coupling_J, const double temperature)
-{
-    double action = 0.0;
-    double sum = 0;
-    for (int ix = 0; ix != nx; ix++)
-    {
-        int ixp1 = (ix + 1) % nx;
-        for (int iy = 0; iy != ny; iy++)
-        {
-            int iyp1 = (iy + 1) % ny;
-            sum = sum + std::cos(2 * pi * spin[ix][iy] / Q - 2 * pi * spin[ixp1][iy] / Q) + std::cos(2 * pi * spin[ix][iy] / Q - 2 * pi * spin[ix][iyp1] / Q);
-        }
-    }
-    action = sum * coupling_J / temperature * (-1e0);
+using Lattice = mcmc::SquareLattice<mcmc::Clock<Q>, L>;
+using Checkerboard = mcmc::QStateCheckerboardMetropolis<Lattice>;
+using Update = std::conditional_t<checkerboard,
+                                  std::conditional_t<parallel, mcmc::ParallelCheckerboard<Checkerboard>, Checkerboard>,
+                                  mcmc::Metropolis<Lattice>>;
 
-    return action;
-}
-
-double calc_action_change(const int spin[nx][ny], const int next_spin, const double coupling_J, const double temperature, const int ix, const int iy)
+// everything one temperature carries from sweep to sweep
+struct Run
 {
-    double action_change = 0e0;
-    // double sum_change=0;
-
-    int ixp1 = (ix + 1) % nx;      // ixp1=ix+1;
-    int iyp1 = (iy + 1) % ny;      // iyp1=iy+1;
-    int ixm1 = (ix - 1 + nx) % nx; // ixm1=ix-1;
-    int iym1 = (iy - 1 + ny) % ny; // iym1=iy-1;
-
-    double sum_change = std::cos(2 * pi * spin[ix][iy] / Q - 2 * pi * spin[ixp1][iy] / Q) +
-                        std::cos(2 * pi * spin[ix][iy] / Q - 2 * pi * spin[ix][iyp1] / Q) +
-                        std::cos(2 * pi * spin[ix][iy] / Q - 2 * pi * spin[ixm1][iy] / Q) +
-                        std::cos(2 * pi * spin[ix][iy] / Q - 2 * pi * spin[ix][iym1] / Q) -
-                        std::cos(2 * pi * next_spin / Q - 2 * pi * spin[ixp1][iy] / Q) -
-                        std::cos(2 * pi * next_spin / Q - 2 * pi * spin[ix][iyp1] / Q) -
-                        std::cos(2 * pi * next_spin / Q - 2 * pi * spin[ixm1][iy] / Q) -
-                        std::cos(2 * pi * next_spin / Q - 2 * pi * spin[ix][iym1] / Q);
+    Run(const std::uint64_t run_seed, const int conf, const double T)
+        : rng(run_seed, conf), metropolis(coupling_J, 0e0, T), equilibration(ntherm, nskip_therm) {}
 
-    action_change = sum_change * coupling_J / temperature;
-
-    return action_change;
-}
-
-double calc_total_spin(const int spin[nx][ny])
-{
-    double total_spin = 0;
-    for (int ix = 0; ix < nx; ix++)
-    {
-        for (int iy = 0; iy < ny; iy++)
-        {
-            total_spin += spin[ix][iy];
-        }
-    }
-    if (total_spin < 0)
-    {
-        total_spin = -total_spin;
-    }
-    return total_spin;
-}
+    Lattice spin;
+    mcmc::Xoshiro256ss rng; // one stream per temperature
+    Update metropolis;
+    long int iter = 0;
+    bool finished = false;
+    mcmc::Jackknife<2> moments;     // m^2, m^4
+    mcmc::RunController controller; // measures every ~2 tau_int sweeps
+    mcmc::Equilibration equilibration; // MSER test on the energy
 
-double calc_squared_magnetization(const int spin[nx][ny])
-{
-    std::vector<double> m(Q, 0.0);
-    for (int ix = 0; ix < nx; ix++)
+    template <class Archive>
+    void checkpoint(Archive &archive)
     {
-        for (int iy = 0; iy < ny; iy++)
+        archive(spin);
+        archive(rng);
+        if constexpr (mcmc::has_checkpoint<Update>::value)
         {
-            m[spin[ix][iy]] += 1;
+            archive(metropolis);
         }
+        archive(iter);
+        archive(finished);
+        archive(moments);
+        archive(controller);
+        archive(equilibration);
     }
-    for (int i = 0; i < Q; i++)
-    {
-        m[i] /= static_cast<double>(nx * ny);
-    }
-    double m2 = 0.0;
-    for (int i = 0; i < Q; i++)
-    {
-        m2 += m[i] * m[i];
-    }
-    for (int i = 0; i < Q - 1; i++)
-    {
-        for (int j = i + 1; j < Q; j++)
-        {
-            m2 -= 2.0 * m[i] * m[j] / (Q - 1);
-        }
-    }
-    return m2;
-}
+};
 
-int main()
+int main(int argc, char *argv[])
 {
     double temperature[nconf + 1];
     double sum = t_start;
@@ -113,94 +81,125 @@ int main()
         temperature[i] = sum;
         sum += 0.01;
     }
-    std::ofstream outputfile("output/2d_Clock_L" + std::to_string(L) + "_q=" + std::to_string(Q) + "_parameter_metropolis.txt");
+    const std::string outputname = "output/2d_Clock_L" + std::to_string(L) + "_q=" + std::to_string(Q) + "_parameter_metropolis.txt";
+    const std::string checkpointname = "output/2d_Clock_L" + std::to_string(L) + "_q=" + std::to_string(Q) + "_checkpoint_metropolis.bin";
+    const bool resume = argc > 1 && std::string(argv[1]) == "--resume";
+    mcmc::Checkpoint checkpoint(checkpointname, nconf + 1, mcmc::make_seed(seed), resume, checkpoint_interval);
+    const std::uint64_t run_seed = checkpoint.seed(); // the interrupted run's seed after --resume
+    std::cout << "seed " << run_seed << std::endl;
+    // temperatures run as independent tasks (build with -fopenmp), unless the strips of each sweep take the threads;
+    // results are written in temperature order
+    std::vector<double> cost(nconf + 1);
     for (int conf = 0; conf < nconf + 1; conf++)
     {
-        double T = temperature[conf];
-        // 初期化
-        int count = 0;
-        int total_m2 = 0;
-        int total_m4 = 0;
-        int spin[nx][ny];
-        srand((unsigned)time(NULL));
-        if (nconfig == 1)
+        cost[conf] = mcmc::critical_slowing_cost(temperature[conf], t_critical);
+    }
+    std::vector<long int> nsample(nconf + 1);
+    std::vector<mcmc::Estimate> binder(nconf + 1);
+    std::vector<double> autocorrelation_time(nconf + 1);
+    std::vector<long int> stride(nconf + 1);
+    std::vector<long int> burn_in(nconf + 1);
+    // 初期化: every temperature is restored before the first sweep, so a snapshot
+    // written with other settings (L, Q, update, threads) stops the scan here
+    std::deque<Run> runs;
+    for (int conf = 0; conf < nconf + 1; conf++)
+    {
+        runs.emplace_back(run_seed, conf, temperature[conf]);
+        Run &run = runs.back();
+        bool restored;
+        try
         {
-            for (int ix = 0; ix != nx; ix++)
-            {
-                for (int iy = 0; iy != ny; iy++)
-                {
-                    spin[ix][iy] = 1;
-                }
-            }
+            restored = checkpoint.restore(conf, run);
         }
-        if (nconfig == -1)
+        catch (const std::runtime_error &error)
         {
-            for (int ix = 0; ix != nx; ix++)
-            {
-                for (int iy = 0; iy != ny; iy++)
-                {
-                    spin[ix][iy] = -1;
-                }
-            }
+            std::cout << error.what() << std::endl;
+            return 1;
         }
-        if (nconfig == 0)
+        if (!restored)
         {
-            std::ifstream inputconfig("output/2d_Clock_Metropolis_output_config.txt");
-            if (!inputconfig)
-            {
-                std::cout << "inputfile not found" << std::endl;
-                exit(1);
-            }
-            for (int ix = 0; ix != nx; ix++)
-            {
-                for (int iy = 0; iy != ny; iy++)
-                {
-                    inputconfig >> ix >> iy >> spin[ix][iy];
-                }
-            }
-            inputconfig.close();
+            mcmc::log_seed(outputname, run.rng);
+            mcmc::init_config(run.spin, nconfig, "output/2d_Clock_Metropolis_output_config.txt");
         }
+    }
+    auto task = [&](const int conf)
+    {
+        double T = temperature[conf];
+        Run &run = runs[conf];
+        auto binder_of = [](const auto &m)
+        { return m[1] / m[0] / m[0]; };
         // 各温度でのモンテカルロシミュレーション
-        for (long int iter = 0; iter != monte_carlo_step; iter++)
+        mcmc::ReflectionWolff<Lattice> cluster(coupling_J, T);
+        while (!run.finished && run.iter != niter)
         {
-            double rand_site = (double)rand() / RAND_MAX;
-            rand_site = rand_site * nx * ny;
-            int ix = (int)rand_site / ny;
-            int iy = (int)rand_site % ny;
-            double metropolis = (double)rand() / RAND_MAX;
-            int next_spin = rand() % Q;
-            double action_change = calc_action_change(spin, next_spin, coupling_J, T, ix, iy);
-            if (exp(-action_change) > metropolis)
+            if (wolff)
             {
-                // accept
-                spin[ix][iy] = next_spin; // flip
+                cluster.step(run.spin, run.rng);
             }
             else
             {
-                // reject
+                run.metropolis.sweep(run.spin, run.rng);
             }
-            if (iter > 1000 * nx * ny && (iter + 1) % nskip == 0)
+            if (!run.equilibration.equilibrated())
             {
-                double m2 = calc_squared_magnetization(spin);
-                total_m2 += m2;
-                total_m4 += m2*m2;
-                count++;
+                if (run.equilibration.tick())
+                {
+                    run.equilibration.add(mcmc::calc_energy(run.spin, coupling_J));
+                }
+            }
+            else if (run.controller.tick())
+            {
+                double m2 = mcmc::calc_squared_magnetization(run.spin);
+                run.moments.add({m2, m2 * m2});
+                run.controller.record(m2);
+                run.finished = run.controller.check() && mcmc::within(run.moments.estimate(binder_of), target_error);
             }
+            run.iter++;
+            if (run.iter % checkpoint_every == 0)
+            {
+                checkpoint.save(conf, run);
+            }
+        }
+        checkpoint.save(conf, run);
+        nsample[conf] = run.moments.count();
+        binder[conf] = run.moments.estimate(binder_of);
+        autocorrelation_time[conf] = run.controller.autocorrelation_time();
+        stride[conf] = run.controller.get_stride();
+        burn_in[conf] = run.equilibration.burn_in();
+    };
+    // strips and tasks exclude each other: a sweep nested in a task would get a team of one thread
+    if (parallel)
+    {
+        for (int conf = 0; conf < nconf + 1; conf++)
+        {
+            task(conf);
         }
-        std::cout << count << std::endl;
-        total_m2 /= count;
-        total_m4 /= count;
+    }
+    else
+    {
+        mcmc::run_tasks(cost, task);
+    }
 
-        double binder_ratio = total_m4 / total_m2 / total_m2;
+    // T, Binder ratio, its error
+    std::ofstream outputfile(outputname);
+    for (int conf = 0; conf < nconf + 1; conf++)
+    {
+        double T = temperature[conf];
+        double binder_ratio = binder[conf].value;
+        std::cout << nsample[conf] << std::endl;
         std::cout << std::fixed << std::setprecision(4)
                   << T << "   "
-                  << binder_ratio << "   "
+                  << binder_ratio << " +- " << binder[conf].error << "   "
+                  << "tau_int(m^2) " << autocorrelation_time[conf] << "   "
+                  << "stride " << stride[conf] << "   "
+                  << "burn-in " << burn_in[conf] << " (E every " << nskip_therm << ")   "
                   << std::endl;
         outputfile << std::fixed << std::setprecision(4)
                    << T << "   "
                    << binder_ratio << "   "
+                   << binder[conf].error << "   "
                    << std::endl;
     }
     outputfile.close();
     return 0;
-}
\ No newline at end of file
+}
@@ -1,71 +1,33 @@
 #include <iostream>
+#include <iomanip>
 #include <cmath>
 #include <fstream>
-const long int niter = 100000;
+#include <type_traits>
+#include <vector>
+#include "../engine/spin_engine.hpp"
+#include "../engine/schedule.hpp"
+#include "../engine/statistics.hpp"
+#include "../engine/checkerboard.hpp"
+#include "../engine/multispin.hpp"
+const long int niter = 100000; // cap on sweeps per temperature
 const int L = 16;
 const int nx = L; // number of sites along x-direction
 const int ny = L; // number of sites along y-direction
-const int monte_carlo_step = niter * nx * ny;
 const double coupling_J = 1.0;
 const int nconf = 60;
 const double t_start = 1.9;
-const int nskip = nx * ny * 10; // Frequency of measurement
+const double t_critical = 2.269; // runs near here are started first: 2 / ln(1 + sqrt(2))
+const int ntherm = 1000; // cap on burn-in sweeps; it ends earlier once the energy is stationary
+const int nskip_therm = 4; // sweeps between the energies of the burn-in test, an O(N) scan of replica 0
+const double target_error = 0.01; // relative error on M, chi and C at which a temperature stops
 const int nconfig = 1;
+const int nupdate = 2; // 0 -> random-site; 1 -> checkerboard; 2 -> multi-spin coding (64 replicas)
+const std::uint64_t seed = 0; // 0 -> fresh seed (recorded in seed_log.txt); otherwise rerun that seed
 
-double calc_energy(const int spin[nx][ny], const double coupling_J, const double temperature)
-{
-    double action = 0.0;
-    int sum = 0;
-    for (int ix = 0; ix != nx; ix++)
-    {
-        int ixp1 = (ix + 1) % nx;
-        for (int iy = 0; iy != ny; iy++)
-        {
-            int iyp1 = (iy + 1) % ny;
-            sum = sum + spin[ix][iy] * spin[ixp1][iy]
-                      + spin[ix][iy] * spin[ix][iyp1];
-        }
-    }
-    action = sum * coupling_J / temperature * (-1e0);
-
-    return action;
-}
-
-double calc_action_change(const int spin[nx][ny], const double coupling_J, const double temperature, const int ix, const int iy)
-{
-    double action_change = 0e0;
-
-    int ixp1 = (ix + 1) % nx;
-    int iyp1 = (iy + 1) % ny;
-    int ixm1 = (ix - 1 + nx) % nx;
-    int iym1 = (iy - 1 + ny) % ny;
-
-    double sum_change = 2 * spin[ix][iy] * spin[ixp1][iy] + 
-                        2 * spin[ix][iy] * spin[ix][iyp1] + 
-                        2 * spin[ix][iy] * spin[ixm1][iy] + 
-                        2 * spin[ix][iy] * spin[ix][iym1];
-
-    action_change = sum_change * coupling_J / temperature;
-
-    return action_change;
-}
-
-double calc_total_spin(const int spin[nx][ny])
-{
-    double total_spin = 0;
-    for (int ix = 0; ix < nx; ix++)
-    {
-        for (int iy = 0; iy < ny; iy++)
-        {
-            total_spin += spin[ix][iy];
-        }
-    }
-    if (total_spin < 0)
-    {
-        total_spin = -total_spin;
-    }
-    return total_spin;
-}
+using Lattice = std::conditional_t<nupdate == 2, mcmc::MultiSpinIsing<L>,
+                                   std::conditional_t<nupdate == 1, mcmc::CheckerboardIsing<L>, mcmc::SquareLattice<mcmc::Ising, L>>>;
+using Update = std::conditional_t<nupdate == 2, mcmc::MultiSpinMetropolis<L>,
+                                  std::conditional_t<nupdate == 1, mcmc::CheckerboardMetropolis<L>, mcmc::Metropolis<Lattice>>>;
 
 int main()
 {
@@ -76,106 +38,106 @@ int main()
         temperature[i] = sum;
         sum += 0.01;
     }
-    std::ofstream outputfile("../output/2d_Ising_L" + std::to_string(L) + "_parameter_metropolis.txt");
+    const std::uint64_t run_seed = mcmc::make_seed(seed);
+    std::cout << "seed " << run_seed << std::endl;
+    const std::string outputname = "../output/2d_Ising_L" + std::to_string(L) + "_parameter_metropolis.txt";
+    // temperatures run as independent tasks (build with -fopenmp); results are written in temperature order
+    std::vector<double> cost(nconf + 1);
     for (int conf = 0; conf < nconf + 1; conf++)
     {
+        cost[conf] = mcmc::critical_slowing_cost(temperature[conf], t_critical);
+    }
+    std::vector<long int> nsample(nconf + 1);
+    std::vector<mcmc::Estimate> magnetization(nconf + 1);
+    std::vector<mcmc::Estimate> magnetic_susceptibility(nconf + 1);
+    std::vector<mcmc::Estimate> specific_heat(nconf + 1);
+    std::vector<double> autocorrelation_time(nconf + 1);
+    std::vector<long int> stride(nconf + 1);
+    std::vector<long int> burn_in(nconf + 1);
+    mcmc::run_tasks(cost, [&](const int conf)
+                    {
         double T = temperature[conf];
         // 初期化
-        int count = 0;
-        int total_spin_sum = 0;
-        int squared_total_spin_sum = 0;
-        double energy_sum = 0;
-        double squared_energy_sum = 0;
-        int spin[nx][ny];
-        srand((unsigned)time(NULL));
-        if (nconfig == 1)
+        mcmc::Jackknife<4> moments; // |M|, M^2, E, E^2 of every replica
+        mcmc::RunController controller; // measures every ~2 tau_int sweeps (of replica 0)
+        mcmc::Equilibration equilibration(ntherm, nskip_therm); // MSER test on the energy
+        // derived quantities of the means of |M|, M^2, E, E^2
+        auto magnetization_of = [](const auto &m)
+        { return m[0] / (nx * ny); };
+        auto susceptibility_of = [T](const auto &m)
+        { return (m[1] - m[0] * m[0]) / (T * nx * ny); };
+        auto specific_heat_of = [T](const auto &m)
+        { return (m[3] - m[2] * m[2]) / (T * T * nx * ny); };
+        Lattice spin;
+        mcmc::Xoshiro256ss rng(run_seed, conf); // one stream per temperature
+        mcmc::log_seed(outputname, rng);
+        mcmc::init_config(spin, nconfig, "output/2d_Ising_Metropolis_output_config.txt");
+        // 各温度でのモンテカルロシミュレーション
+        Update metropolis(coupling_J, 0e0, T);
+        for (long int iter = 0; iter != niter; iter++)
         {
-            for (int ix = 0; ix != nx; ix++)
+            metropolis.sweep(spin, rng);
+            if (!equilibration.equilibrated())
             {
-                for (int iy = 0; iy != ny; iy++)
+                if (equilibration.tick())
                 {
-                    spin[ix][iy] = 1;
+                    equilibration.add(mcmc::calc_energy(mcmc::replica(spin, 0), coupling_J));
                 }
             }
-        }
-        if (nconfig == -1)
-        {
-            for (int ix = 0; ix != nx; ix++)
+            else if (controller.tick())
             {
-                for (int iy = 0; iy != ny; iy++)
+                for (int r = 0; r != mcmc::replica_count<Lattice>::value; r++)
                 {
-                    spin[ix][iy] = -1;
+                    const auto &config = mcmc::replica(spin, r);
+                    double total_spin = std::abs(mcmc::calc_total_spin(config));
+                    double energy = mcmc::calc_energy(config, coupling_J);
+                    moments.add({total_spin, total_spin * total_spin, energy, energy * energy});
+                    if (r == 0)
+                    {
+                        controller.record(total_spin);
+                    }
                 }
-            }
-        }
-        if (nconfig == 0)
-        {
-            std::ifstream inputconfig("output/2d_Ising_Metropolis_output_config.txt");
-            if (!inputconfig)
-            {
-                std::cout << "inputfile not found" << std::endl;
-                exit(1);
-            }
-            for (int ix = 0; ix != nx; ix++)
-            {
-                for (int iy = 0; iy != ny; iy++)
+                if (controller.check() && mcmc::within(moments.estimate(magnetization_of), target_error) &&
+                    mcmc::within(moments.estimate(susceptibility_of), target_error) &&
+                    mcmc::within(moments.estimate(specific_heat_of), target_error))
                 {
-                    inputconfig >> ix >> iy >> spin[ix][iy];
+                    break;
                 }
             }
-            inputconfig.close();
         }
-        // 各温度でのモンテカルロシミュレーション
-        for (long int iter = 0; iter != monte_carlo_step; iter++)
-        {
-            double rand_site = (double)rand() / RAND_MAX;
-            rand_site = rand_site * nx * ny;
-            int ix = (int)rand_site / ny;
-            int iy = (int)rand_site % ny;
-            double metropolis = (double)rand() / RAND_MAX;
-            double action_change = calc_action_change(spin, coupling_J, T, ix, iy);
-            if (exp(-action_change) > metropolis)
-            {
-                // accept
-                spin[ix][iy] = -spin[ix][iy]; // flip
-            }
-            else
-            {
-                // reject
-            }
-            if (iter > 1000 * nx * ny && (iter + 1) % nskip == 0)
-            {
-                double total_spin = calc_total_spin(spin);
-                total_spin_sum += total_spin;
-                squared_total_spin_sum += total_spin * total_spin;
-                double energy = calc_energy(spin, coupling_J, T);
-                energy_sum += energy;
-                squared_energy_sum += energy * energy;
-                count++;
-            }
-        }
-        std::cout << count << std::endl;
-        double M = total_spin_sum / count;
-        double squared_total_spin_moment = squared_total_spin_sum / count;
-        double E = energy_sum / count;
-        double squared_energy_moment = squared_energy_sum / count;
+        nsample[conf] = moments.count();
+        magnetization[conf] = moments.estimate(magnetization_of);
+        magnetic_susceptibility[conf] = moments.estimate(susceptibility_of);
+        specific_heat[conf] = moments.estimate(specific_heat_of);
+        autocorrelation_time[conf] = controller.autocorrelation_time();
+        stride[conf] = controller.get_stride();
+        burn_in[conf] = equilibration.burn_in(); });
 
-        double magnetization = M / (nx * ny);
-        double magnetic_susceptibility = (squared_total_spin_moment - M * M) / (T * nx * ny);
-        double specific_heat = (squared_energy_moment - E * E) / (T * T * nx * ny);
+    // T, M, chi, C, then their errors; the first four columns are as before
+    std::ofstream outputfile(outputname);
+    for (int conf = 0; conf < nconf + 1; conf++)
+    {
+        double T = temperature[conf];
+        std::cout << nsample[conf] << std::endl;
         std::cout << std::fixed << std::setprecision(4)
                   << T << "   "
-                  << magnetization << "   "
-                  << magnetic_susceptibility << "   "
-                  << specific_heat << "   "
+                  << magnetization[conf].value << " +- " << magnetization[conf].error << "   "
+                  << magnetic_susceptibility[conf].value << " +- " << magnetic_susceptibility[conf].error << "   "
+                  << specific_heat[conf].value << " +- " << specific_heat[conf].error << "   "
+                  << "tau_int(|M|) " << autocorrelation_time[conf] << "   "
+                  << "stride " << stride[conf] << "   "
+                  << "burn-in " << burn_in[conf] << " (E every " << nskip_therm << ")   "
                   << std::endl;
         outputfile << std::fixed << std::setprecision(4)
                    << T << "   "
-                   << magnetization << "   "
-                   << magnetic_susceptibility << "   "
-                   << specific_heat << "   "
+                   << magnetization[conf].value << "   "
+                   << magnetic_susceptibility[conf].value << "   "
+                   << specific_heat[conf].value << "   "
+                   << magnetization[conf].error << "   "
+                   << magnetic_susceptibility[conf].error << "   "
+                   << specific_heat[conf].error << "   "
                    << std::endl;
     }
     outputfile.close();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <fstream>
+#include <vector>
+#include "../engine/spin_engine.hpp"
+#include "../engine/schedule.hpp"
+#include "../engine/reweighting.hpp"
+const long int niter = 1000000;
+const int L = 16;
+const int nx = L; // number of sites along x-direction
+const int ny = L; // number of sites along y-direction
+const double coupling_J = 1.0;
+const int nrun = 8;               // simulated temperatures
+const double t_start = 2.0;       // simulated: t_start, t_start + dt_run, ...
+const double dt_run = 0.1;
+const int nconf = 700;            // reweighted temperatures
+const double t_first = 2.0;       // reweighted: t_first, t_first + 0.001, ...
+const double t_critical = 2.269;  // runs near here are started first: 2 / ln(1 + sqrt(2))
+const int ntherm = 100000;        // cluster flips discarded before measuring
+const int nskip = 10;
+const std::uint64_t seed = 0; // 0 -> fresh seed (recorded in seed_log.txt); otherwise rerun that seed
+
+using Lattice = mcmc::SquareLattice<mcmc::Ising, L>;
+
+int main()
+{
+    double temperature[nrun];
+    for (int i = 0; i < nrun; i++)
+    {
+        temperature[i] = t_start + i * dt_run;
+        std::cout << temperature[i] << std::endl;
+    }
+    const std::uint64_t run_seed = mcmc::make_seed(seed);
+    std::cout << "seed " << run_seed << std::endl;
+    const std::string outputname = "../output/2d_Ising_L" + std::to_string(L) + "_parameter_reweighting.txt";
+    // a sparse set of Wolff runs, one task per temperature (build with -fopenmp)
+    std::vector<double> cost(nrun);
+    for (int run = 0; run < nrun; run++)
+    {
+        cost[run] = mcmc::critical_slowing_cost(temperature[run], t_critical);
+    }
+    std::vector<std::vector<double>> energy_series(nrun);
+    std::vector<std::vector<double>> total_spin_series(nrun);
+    mcmc::run_tasks(cost, [&](const int run)
+                    {
+        double T = temperature[run];
+        Lattice spin;
+        mcmc::Xoshiro256ss rng(run_seed, run); // one stream per temperature
+        mcmc::log_seed(outputname, rng);
+        spin.fill(mcmc::Ising::state(1));
+        mcmc::RunningTotals<mcmc::Ising> totals(spin);
+
+        mcmc::Wolff<Lattice> wolff(coupling_J, T);
+        for (long int iter = 0; iter != niter; iter++)
+        {
+            wolff.step(spin, rng, &totals);
+
+            if (iter >= ntherm && (iter + 1) % nskip == 0)
+            {
+                energy_series[run].push_back(totals.energy(coupling_J));
+                total_spin_series[run].push_back(totals.total_spin());
+            }
+        } });
+
+    // solve for Z(T_k) from all runs at once, then evaluate on the fine grid
+    mcmc::MultiHistogram histogram(nx * ny);
+    for (int run = 0; run < nrun; run++)
+    {
+        histogram.add_run(temperature[run], energy_series[run], total_spin_series[run]);
+    }
+    const int iterations = histogram.solve();
+    std::cout << "self-consistency iterations " << iterations << std::endl;
+
+    std::ofstream outputfile(outputname);
+    for (int conf = 0; conf < nconf + 1; conf++)
+    {
+        const mcmc::ReweightedEstimate estimate = histogram.at(t_first + conf * 0.001);
+        outputfile << std::fixed << std::setprecision(4)
+                   << estimate.temperature << "   "
+                   << estimate.magnetization << "   "
+                   << estimate.magnetic_susceptibility << "   "
+                   << estimate.specific_heat << "   "
+                   << estimate.binder_ratio << "   "
+                   << std::endl;
+        if (conf % 10 == 0)
+        {
+            std::cout << std::fixed << std::setprecision(4)
+                      << estimate.temperature << "   "
+                      << estimate.magnetization << "   "
+                      << estimate.magnetic_susceptibility << "   "
+                      << estimate.specific_heat << "   "
+                      << estimate.binder_ratio << "   "
+                      << std::endl;
+        }
+    }
+    outputfile.close();
+    return 0;
+}
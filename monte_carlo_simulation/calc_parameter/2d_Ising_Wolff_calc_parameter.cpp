@@ -1,168 +1,27 @@
 #include <iostream>
+#include <iomanip>
 #include <cmath>
 #include <fstream>
-const long int niter = 1000000;
+#include <type_traits>
+#include <vector>
+#include "../engine/spin_engine.hpp"
+#include "../engine/schedule.hpp"
+#include "../engine/statistics.hpp"
+const long int niter = 1000000; // cap on cluster steps per temperature
 const int L = 16;
 const int nx = L; // number of sites along x-direction
 const int ny = L; // number of sites along y-direction
 const double coupling_J = 1.0;
 const int nconf = 60;
 const double t_start = 1.9;
-const int nskip = 100;
+const double t_critical = 2.269; // runs near here are started first: 2 / ln(1 + sqrt(2))
+const int ntherm = 100000; // cap on burn-in cluster steps; it ends earlier once the energy is stationary
+const double target_error = 0.01; // relative error on M, chi and C at which a temperature stops
+const bool swendsen_wang = false; // true -> Swendsen-Wang (every step relabels the whole lattice); false -> Wolff
+const std::uint64_t seed = 0; // 0 -> fresh seed (recorded in seed_log.txt); otherwise rerun that seed
 
-double calc_energy(const int spin[nx][ny], const double coupling_J, const double temperature)
-{
-    double action = 0.0;
-    double sum = 0;
-    for (int ix = 0; ix != nx; ix++)
-    {
-        int ixp1 = (ix + 1) % nx;
-        for (int iy = 0; iy != ny; iy++)
-        {
-            int iyp1 = (iy + 1) % ny;
-            sum = sum + spin[ix][iy] * spin[ixp1][iy]
-                      + spin[ix][iy] * spin[ix][iyp1];
-        }
-    }
-    action = sum * coupling_J / temperature * (-1e0);
-
-    return action;
-}
-
-double calc_action(const int spin[nx][ny], const double coupling_J, const double temperature)
-{
-    double action = 0e0;
-    double sum = 0;
-    for (int ix = 0; ix != nx; ix++)
-    {
-        int ixp1 = (ix + 1) % nx;
-        for (int iy = 0; iy != ny; iy++)
-        {
-            int iyp1 = (iy + 1) % ny;
-            sum = sum + spin[ix][iy] * spin[ixp1][iy] + spin[ix][iy] * spin[ix][iyp1];
-        }
-    }
-    action = sum * coupling_J / temperature * (-1e0);
-
-    return action;
-}
-
-int calc_total_spin(const int spin[nx][ny])
-{
-    int total_spin = 0;
-    for (int ix = 0; ix != nx; ix++)
-    {
-        for (int iy = 0; iy != ny; iy++)
-        {
-            total_spin = total_spin + spin[ix][iy];
-        }
-    }
-    if(total_spin < 0)
-    {
-        total_spin = -total_spin;
-    }
-    return total_spin;
-}
-
-double calc_magnetization(const int total_spin, const int total_sampling)
-{
-    double magnetization = 0;
-    magnetization = total_spin / total_sampling;
-    if (magnetization < 0)
-    {
-        magnetization = -magnetization;
-    }
-    return magnetization;
-}
-
-int make_cluster(const int spin[nx][ny], const double coupling_J,
-                 const double temperature, int &n_cluster, int (&i_cluster)[nx * ny][2])
-{
-    int in_or_out[nx][ny];
-    for (int ix = 0; ix != nx; ix++)
-    {
-        for (int iy = 0; iy != ny; iy++)
-        {
-            in_or_out[ix][iy] = 1;
-        }
-    }
-    // in_or_out[ix][iy] = 1 -> not in the cluster; 0 -> in the cluster.
-    double rand_site = (double)rand() / RAND_MAX;
-    rand_site = rand_site * nx * ny;
-    int ix = (int)rand_site / ny;
-    int iy = (int)rand_site % ny;
-    in_or_out[ix][iy] = 0;
-    i_cluster[0][0] = ix;
-    i_cluster[0][1] = iy;
-    int spin_cluster = spin[ix][iy];
-    n_cluster = 1;
-    double probability = 1e0 - exp(-2e0 * coupling_J / temperature);
-    int k = 0;
-    while (k < n_cluster)
-    {
-        ix = i_cluster[k][0];
-        iy = i_cluster[k][1];
-        int ixp1 = (ix + 1) % nx;
-        int iyp1 = (iy + 1) % ny;
-        int ixm1 = (ix - 1 + nx) % nx;
-        int iym1 = (iy - 1 + ny) % ny;
-
-        if (spin[ixp1][iy] == spin_cluster)
-        {
-            if (in_or_out[ixp1][iy] == 1)
-            {
-                if ((double)rand() / RAND_MAX < probability)
-                {
-                    i_cluster[n_cluster][0] = ixp1;
-                    i_cluster[n_cluster][1] = iy;
-                    n_cluster = n_cluster + 1;
-                    in_or_out[ixp1][iy] = 0;
-                }
-            }
-        }
-        if (spin[ix][iyp1] == spin_cluster)
-        {
-            if (in_or_out[ix][iyp1] == 1)
-            {
-                if ((double)rand() / RAND_MAX < probability)
-                {
-                    i_cluster[n_cluster][0] = ix;
-                    i_cluster[n_cluster][1] = iyp1;
-                    n_cluster = n_cluster + 1;
-                    in_or_out[ix][iyp1] = 0;
-                }
-            }
-        }
-        if (spin[ixm1][iy] == spin_cluster)
-        {
-            if (in_or_out[ixm1][iy] == 1)
-            {
-                if ((double)rand() / RAND_MAX < probability)
-                {
-                    i_cluster[n_cluster][0] = ixm1;
-                    i_cluster[n_cluster][1] = iy;
-                    n_cluster = n_cluster + 1;
-                    in_or_out[ixm1][iy] = 0;
-                }
-            }
-        }
-        if (spin[ix][iym1] == spin_cluster)
-        {
-            if (in_or_out[ix][iym1] == 1)
-            {
-                if ((double)rand() / RAND_MAX < probability)
-                {
-                    i_cluster[n_cluster][0] = ix;
-                    i_cluster[n_cluster][1] = iym1;
-                    n_cluster = n_cluster + 1;
-                    in_or_out[ix][iym1] = 0;
-                }
-            }
-        }
-        k = k + 1;
-    }
-    return spin_cluster;
-}
+using Lattice = mcmc::SquareLattice<mcmc::Ising, L>;
+using Update = std::conditional_t<swendsen_wang, mcmc::SwendsenWang<Lattice>, mcmc::Wolff<Lattice>>;
 
 int main()
 {
@@ -174,69 +33,92 @@ int main()
         sum += 0.01;
         std::cout << temperature[i] << std::endl;
     }
-    std::ofstream outputfile("../output/2d_Ising_L" + std::to_string(L) + "_parameter_wolff.txt");
+    const std::uint64_t run_seed = mcmc::make_seed(seed);
+    std::cout << "seed " << run_seed << std::endl;
+    const std::string outputname = "../output/2d_Ising_L" + std::to_string(L) + "_parameter_wolff.txt";
+    // temperatures run as independent tasks (build with -fopenmp); results are written in temperature order
+    std::vector<double> cost(nconf + 1);
     for (int conf = 0; conf < nconf + 1; conf++)
     {
+        cost[conf] = mcmc::critical_slowing_cost(temperature[conf], t_critical);
+    }
+    std::vector<mcmc::Estimate> magnetization(nconf + 1);
+    std::vector<mcmc::Estimate> magnetic_susceptibility(nconf + 1);
+    std::vector<mcmc::Estimate> specific_heat(nconf + 1);
+    std::vector<double> autocorrelation_time(nconf + 1);
+    std::vector<long int> stride(nconf + 1);
+    std::vector<long int> burn_in(nconf + 1);
+    mcmc::run_tasks(cost, [&](const int conf)
+                    {
         double T = temperature[conf];
-        int count = 0;
-        double total_spin_sum = 0;
-        double squared_total_spin_sum = 0;
-        double energy_sum = 0;
-        double squared_energy_sum = 0;
-        int spin[nx][ny];
-        srand((unsigned)time(NULL));
-        for (int ix = 0; ix != nx; ix++)
-        {
-            for (int iy = 0; iy != ny; iy++)
-            {
-                spin[ix][iy] = 1;
-            }
-        }
+        mcmc::Jackknife<4> moments; // |M|, M^2, E, E^2
+        mcmc::RunController controller; // measures every ~2 tau_int steps
+        mcmc::Equilibration equilibration(ntherm); // MSER test on the energy
+        // derived quantities of the means of |M|, M^2, E, E^2
+        auto magnetization_of = [](const auto &m)
+        { return m[0] / (nx * ny); };
+        auto susceptibility_of = [T](const auto &m)
+        { return (m[1] - m[0] * m[0]) / (T * nx * ny); };
+        auto specific_heat_of = [T](const auto &m)
+        { return (m[3] - m[2] * m[2]) / (T * T * nx * ny); };
+        Lattice spin;
+        mcmc::Xoshiro256ss rng(run_seed, conf); // one stream per temperature
+        mcmc::log_seed(outputname, rng);
+        spin.fill(mcmc::Ising::state(1));
+        mcmc::RunningTotals<mcmc::Ising> totals(spin); // follows every cluster flip
 
+        Update cluster(coupling_J, T);
         for (long int iter = 0; iter != niter; iter++)
         {
-            int n_cluster;
-            int i_cluster[nx * ny][2];
-            int spin_cluster = make_cluster(spin, coupling_J, T, n_cluster, i_cluster);
-            double metropolis = (double)rand() / RAND_MAX;
-            for (int k = 0; k != n_cluster; k++)
+            cluster.step(spin, rng, &totals);
+
+            if (!equilibration.equilibrated())
             {
-                int ix = i_cluster[k][0];
-                int iy = i_cluster[k][1];
-                spin[ix][iy] = -spin[ix][iy];
+                equilibration.add(totals.energy(coupling_J));
             }
-
-            if (iter > 100000 && (iter + 1) % nskip == 0)
+            else if (controller.tick())
             {
-                double total_spin = calc_total_spin(spin);
-                total_spin_sum += total_spin;
-                squared_total_spin_sum += total_spin * total_spin;
-                double energy = calc_energy(spin, coupling_J, T);
-                energy_sum += energy;
-                squared_energy_sum += energy * energy;
-                count++;
+                double total_spin = std::abs(totals.total_spin());
+                double energy = totals.energy(coupling_J);
+                moments.add({total_spin, total_spin * total_spin, energy, energy * energy});
+                controller.record(total_spin);
+                if (controller.check() && mcmc::within(moments.estimate(magnetization_of), target_error) &&
+                    mcmc::within(moments.estimate(susceptibility_of), target_error) &&
+                    mcmc::within(moments.estimate(specific_heat_of), target_error))
+                {
+                    break;
+                }
             }
         }
-        // std::cout << count << std::endl;
-        double M = total_spin_sum / count;
-        double squared_total_spin_moment = squared_total_spin_sum / count;
-        double E = energy_sum / count;
-        double squared_energy_moment = squared_energy_sum / count;
+        magnetization[conf] = moments.estimate(magnetization_of);
+        magnetic_susceptibility[conf] = moments.estimate(susceptibility_of);
+        specific_heat[conf] = moments.estimate(specific_heat_of);
+        autocorrelation_time[conf] = controller.autocorrelation_time();
+        stride[conf] = controller.get_stride();
+        burn_in[conf] = equilibration.burn_in(); });
 
-        double magnetization = M / (nx * ny);
-        double magnetic_susceptibility = (squared_total_spin_moment - M * M) / (T * nx * ny);
-        double specific_heat = (squared_energy_moment - E * E) / (T * T * nx * ny);
+    // T, M, chi, C, then their errors; the first four columns are as before
+    std::ofstream outputfile(outputname);
+    for (int conf = 0; conf < nconf + 1; conf++)
+    {
+        double T = temperature[conf];
         std::cout << std::fixed << std::setprecision(4)
                   << T << "   "
-                  << magnetization << "   "
-                  << magnetic_susceptibility << "   "
-                  << specific_heat << "   "
+                  << magnetization[conf].value << " +- " << magnetization[conf].error << "   "
+                  << magnetic_susceptibility[conf].value << " +- " << magnetic_susceptibility[conf].error << "   "
+                  << specific_heat[conf].value << " +- " << specific_heat[conf].error << "   "
+                  << "tau_int(|M|) " << autocorrelation_time[conf] << "   "
+                  << "stride " << stride[conf] << "   "
+                  << "burn-in " << burn_in[conf] << "   "
                   << std::endl;
         outputfile << std::fixed << std::setprecision(4)
                    << T << "   "
-                   << magnetization << "   "
-                   << magnetic_susceptibility << "   "
-                   << specific_heat << "   "
+                   << magnetization[conf].value << "   "
+                   << magnetic_susceptibility[conf].value << "   "
+                   << specific_heat[conf].value << "   "
+                   << magnetization[conf].error << "   "
+                   << magnetic_susceptibility[conf].error << "   "
+                   << specific_heat[conf].error << "   "
                    << std::endl;
     }
     outputfile.close();
@@ -1,117 +1,28 @@
 #include <iostream>
+#include <iomanip>
 #include <cmath>
 #include <fstream>
 #include <string>
 #include <algorithm>
-const long int niter = 100000;
+#include <vector>
+#include "../engine/spin_engine.hpp"
+#include "../engine/schedule.hpp"
+#include "../engine/statistics.hpp"
+const long int niter = 100000; // cap on sweeps per temperature
 const int L = 128;
 const int nx = L; // number of sites along x-direction
 const int ny = L; // number of sites along y-direction
-const int monte_carlo_step = niter * nx * ny;
 const int Q = 3;
 const double coupling_J = 1.0;
 const int nconf = 60;
 const double t_start = 0.6;
-const int nskip = nx * ny * 10; // Frequency of measurement
+const double t_critical = 0.995; // runs near here are started first: 1 / ln(1 + sqrt(Q))
+const int ntherm = 1000; // cap on burn-in sweeps; it ends earlier once the energy is stationary
+const double target_error = 0.01; // relative error on the Binder ratio at which a temperature stops
 const int nconfig = 1;
+const std::uint64_t seed = 0; // 0 -> fresh seed (recorded in seed_log.txt); otherwise rerun that seed
 
-double kronecker_delta(const int spin_1, const int spin_2)
-{
-    if (spin_1 == spin_2)
-    {
-        return 1;
-    }
-    else
-    {
-        return 0;
-    }
-}
-
-double calc_energy(const int spin[nx][ny], const double coupling_J, const double temperature)
-{
-    double action = 0.0;
-    double sum = 0;
-    for (int ix = 0; ix != nx; ix++)
-    {
-        int ixp1 = (ix + 1) % nx;
-        for (int iy = 0; iy != ny; iy++)
-        {
-            int iyp1 = (iy + 1) % ny;
-            sum = sum + kronecker_delta(spin[ix][iy], spin[ixp1][iy]) + kronecker_delta(spin[ix][iy], spin[ix][iyp1]);
-        }
-    }
-    action = sum * coupling_J / temperature * (-1e0);
-
-    return action;
-}
-
-double calc_action_change(const int spin[nx][ny], const int next_spin, const double coupling_J, const double temperature, const int ix, const int iy)
-{
-    double action_change = 0e0;
-    // double sum_change=0;
-
-    int ixp1 = (ix + 1) % nx;      // ixp1=ix+1; be careful about the boundary condition.
-    int iyp1 = (iy + 1) % ny;      // iyp1=iy+1; be careful about the boundary condition.
-    int ixm1 = (ix - 1 + nx) % nx; // ixm1=ix-1; be careful about the boundary condition.
-    int iym1 = (iy - 1 + ny) % ny; // iym1=iy-1; be careful about the boundary condition.
-
-    double sum_change = kronecker_delta(spin[ix][iy], spin[ixp1][iy]) +
-                        kronecker_delta(spin[ix][iy], spin[ix][iyp1]) +
-                        kronecker_delta(spin[ix][iy], spin[ixm1][iy]) +
-                        kronecker_delta(spin[ix][iy], spin[ix][iym1]) -
-                        kronecker_delta(next_spin, spin[ixp1][iy]) -
-                        kronecker_delta(next_spin, spin[ix][iyp1]) -
-                        kronecker_delta(next_spin, spin[ixm1][iy]) -
-                        kronecker_delta(next_spin, spin[ix][iym1]);
-
-    return action_change;
-}
-
-double calc_total_spin(const int spin[nx][ny])
-{
-    double total_spin = 0;
-    for (int ix = 0; ix < nx; ix++)
-    {
-        for (int iy = 0; iy < ny; iy++)
-        {
-            total_spin += spin[ix][iy];
-        }
-    }
-    if (total_spin < 0)
-    {
-        total_spin = -total_spin;
-    }
-    return total_spin;
-}
-
-double calc_squared_magnetization(const int spin[nx][ny])
-{
-    std::vector<double> m(Q, 0.0);
-    for (int ix = 0; ix < nx; ix++)
-    {
-        for (int iy = 0; iy < ny; iy++)
-        {
-            m[spin[ix][iy]] += 1;
-        }
-    }
-    for (int i = 0; i < Q; i++)
-    {
-        m[i] /= static_cast<double>(nx * ny);
-    }
-    double m2 = 0.0;
-    for (int i = 0; i < Q; i++)
-    {
-        m2 += m[i] * m[i];
-    }
-    for (int i = 0; i < Q - 1; i++)
-    {
-        for (int j = i + 1; j < Q; j++)
-        {
-            m2 -= 2.0 * m[i] * m[j] / (Q - 1);
-        }
-    }
-    return m2;
-}
+using Lattice = mcmc::SquareLattice<mcmc::Potts<Q>, L>;
 
 int main()
 {
@@ -122,94 +33,80 @@ int main()
         temperature[i] = sum;
         sum += 0.01;
     }
-    std::ofstream outputfile("../output/2d_Potts_L" + std::to_string(L) + "_q=" + std::to_string(Q) + "_parameter_metropolis.txt");
+    const std::uint64_t run_seed = mcmc::make_seed(seed);
+    std::cout << "seed " << run_seed << std::endl;
+    const std::string outputname = "../output/2d_Potts_L" + std::to_string(L) + "_q=" + std::to_string(Q) + "_parameter_metropolis.txt";
+    // temperatures run as independent tasks (build with -fopenmp); results are written in temperature order
+    std::vector<double> cost(nconf + 1);
     for (int conf = 0; conf < nconf + 1; conf++)
     {
+        cost[conf] = mcmc::critical_slowing_cost(temperature[conf], t_critical);
+    }
+    std::vector<long int> nsample(nconf + 1);
+    std::vector<mcmc::Estimate> binder(nconf + 1);
+    std::vector<double> autocorrelation_time(nconf + 1);
+    std::vector<long int> stride(nconf + 1);
+    std::vector<long int> burn_in(nconf + 1);
+    mcmc::run_tasks(cost, [&](const int conf)
+                    {
         double T = temperature[conf];
         // 初期化
-        int count = 0;
-        double total_m2 = 0;
-        double total_m4 = 0;
-        int spin[nx][ny];
-        srand((unsigned)time(NULL));
-        if (nconfig == 1)
-        {
-            for (int ix = 0; ix != nx; ix++)
-            {
-                for (int iy = 0; iy != ny; iy++)
-                {
-                    spin[ix][iy] = 1;
-                }
-            }
-        }
-        if (nconfig == -1)
-        {
-            for (int ix = 0; ix != nx; ix++)
-            {
-                for (int iy = 0; iy != ny; iy++)
-                {
-                    spin[ix][iy] = -1;
-                }
-            }
-        }
-        if (nconfig == 0)
+        mcmc::Jackknife<2> moments; // m^2, m^4
+        mcmc::RunController controller; // measures every ~2 tau_int sweeps
+        mcmc::Equilibration equilibration(ntherm); // MSER test on the energy
+        auto binder_of = [](const auto &m)
+        { return m[1] / m[0] / m[0]; };
+        Lattice spin;
+        mcmc::Xoshiro256ss rng(run_seed, conf); // one stream per temperature
+        mcmc::log_seed(outputname, rng);
+        mcmc::init_config(spin, nconfig, "output/2d_Potts_Metropolis_output_config.txt");
+        mcmc::RunningTotals<Lattice::Model> totals(spin); // follows every accepted move
+        // 各温度でのモンテカルロシミュレーション
+        mcmc::Metropolis<Lattice> metropolis(coupling_J, 0e0, T);
+        for (long int iter = 0; iter != niter; iter++)
         {
-            std::ifstream inputconfig("output/2d_Potts_Metropolis_output_config.txt");
-            if (!inputconfig)
+            metropolis.sweep(spin, rng, &totals);
+            if (!equilibration.equilibrated())
             {
-                std::cout << "inputfile not found" << std::endl;
-                exit(1);
+                equilibration.add(totals.energy(coupling_J));
             }
-            for (int ix = 0; ix != nx; ix++)
+            else if (controller.tick())
             {
-                for (int iy = 0; iy != ny; iy++)
+                double m2 = totals.squared_magnetization();
+                moments.add({m2, m2 * m2});
+                controller.record(m2);
+                if (controller.check() && mcmc::within(moments.estimate(binder_of), target_error))
                 {
-                    inputconfig >> ix >> iy >> spin[ix][iy];
+                    break;
                 }
             }
-            inputconfig.close();
         }
-        // 各温度でのモンテカルロシミュレーション
-        for (long int iter = 0; iter != monte_carlo_step; iter++)
-        {
-            double rand_site = (double)rand() / RAND_MAX;
-            rand_site = rand_site * nx * ny;
-            int ix = (int)rand_site / ny;
-            int iy = (int)rand_site % ny;
-            double metropolis = (double)rand() / RAND_MAX;
-            int next_spin = rand() % Q;
-            double action_change = calc_action_change(spin, next_spin, coupling_J, T, ix, iy);
-            if (exp(-action_change) > metropolis)
-            {
-                // accept
-                spin[ix][iy] = next_spin; // flip
-            }
-            else
-            {
-                // reject
-            }
-            if (iter > 1000 * nx * ny && (iter + 1) % nskip == 0)
-            {
-                double m2 = calc_squared_magnetization(spin);
-                total_m2 += m2;
-                total_m4 += m2*m2;
-                count++;
-            }
-        }
-        std::cout << count << std::endl;
-        total_m2 /= count;
-        total_m4 /= count;
+        nsample[conf] = moments.count();
+        binder[conf] = moments.estimate(binder_of);
+        autocorrelation_time[conf] = controller.autocorrelation_time();
+        stride[conf] = controller.get_stride();
+        burn_in[conf] = equilibration.burn_in(); });
 
-        double binder_ratio = total_m4 / total_m2 / total_m2;
+    // T, Binder ratio, its error
+    std::ofstream outputfile(outputname);
+    for (int conf = 0; conf < nconf + 1; conf++)
+    {
+        double T = temperature[conf];
+        double binder_ratio = binder[conf].value;
+        std::cout << nsample[conf] << std::endl;
         std::cout << std::fixed << std::setprecision(4)
                   << T << "   "
-                  << binder_ratio << "   "
+                  << binder_ratio << " +- " << binder[conf].error << "   "
+                  << "tau_int(m^2) " << autocorrelation_time[conf] << "   "
+                  << "stride " << stride[conf] << "   "
+                  << "burn-in " << burn_in[conf] << "   "
                   << std::endl;
         outputfile << std::fixed << std::setprecision(4)
                    << T << "   "
                    << binder_ratio << "   "
+                   << binder[conf].error << "   "
                    << std::endl;
     }
     outputfile.close();
     return 0;
-}
\ No newline at end of file
+}
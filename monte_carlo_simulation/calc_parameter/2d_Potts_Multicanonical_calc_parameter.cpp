@@ -0,0 +1,116 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../engine/spin_engine.hpp"
+#include "../engine/schedule.hpp"
+#include "../engine/multicanonical.hpp"
+const int L = 16;
+const int nx = L; // number of sites along x-direction
+const int ny = L; // number of sites along y-direction
+const int Q = 5;  // first-order transition at T = 1 / ln(1 + sqrt(5)) = 0.8515
+const double coupling_J = 1.0;
+const int nwindow = 4;            // Wang-Landau energy windows, one thread each
+const double overlap = 0.75;      // fraction of a window shared with the next
+const double flatness = 0.8;      // min H >= flatness * mean H
+const double ln_f_final = 1e-6;   // Wang-Landau stops once every window is below this
+const int nsweep_window = 100;    // sweeps between configuration swaps of neighbouring windows
+const int nwalker = 4;            // independent multicanonical walkers
+const long int niter = 200000;    // multicanonical sweeps per walker
+const int ntherm = 1000;          // sweeps discarded before measuring
+const int nskip = 1;              // Frequency of measurement (sweeps)
+const int nconf = 300;            // reweighted temperatures
+const double t_start = 0.7;       // reweighted: t_start, t_start + 0.001, ...
+const std::uint64_t seed = 0; // 0 -> fresh seed (recorded in seed_log.txt); otherwise rerun that seed
+
+using Lattice = mcmc::SquareLattice<mcmc::Potts<Q>, L>;
+using Totals = mcmc::RunningTotals<Lattice::Model>;
+
+int main()
+{
+    const std::uint64_t run_seed = mcmc::make_seed(seed);
+    std::cout << "seed " << run_seed << std::endl;
+    const std::string outputname = "../output/2d_Potts_L" + std::to_string(L) + "_q=" + std::to_string(Q) + "_parameter_multicanonical.txt";
+    const std::string dosname = "../output/2d_Potts_L" + std::to_string(L) + "_q=" + std::to_string(Q) + "_dos_multicanonical.txt";
+
+    // Wang-Landau density of states from B = 2N/Q (the T = infinity average) up to the ground state B = 2N
+    mcmc::ParallelWangLandau<Lattice> wang_landau(2 * nx * ny / Q, 2 * nx * ny, nwindow, overlap, run_seed);
+    for (int w = 0; w < nwindow; w++)
+    {
+        mcmc::log_seed(dosname, wang_landau.generator(w));
+    }
+    const long int nround = wang_landau.run(ln_f_final, flatness, nsweep_window);
+    std::cout << "Wang-Landau rounds " << nround << std::endl;
+    for (int w = 0; w + 1 < nwindow; w++)
+    {
+        std::cout << "window swap " << w << "-" << w + 1 << "   " << wang_landau.acceptance(w) << std::endl;
+    }
+    const std::vector<double> log_density = wang_landau.log_density();
+
+    // multicanonical production with the frozen ln g, one walker per task
+    std::vector<mcmc::Multicanonical<Lattice>> walker(nwalker, mcmc::Multicanonical<Lattice>(log_density, coupling_J));
+    std::vector<double> cost(nwalker, 1e0);
+    mcmc::run_tasks(cost, [&](const int k)
+                    {
+        Lattice spin;
+        mcmc::Xoshiro256ss rng(run_seed, nwindow + 1 + k); // streams after the Wang-Landau ones
+        mcmc::log_seed(outputname, rng);
+        spin.fill(0);
+        Totals totals(spin);
+        walker[k].enter(spin, rng, totals);
+        for (long int iter = 0; iter != niter; iter++)
+        {
+            walker[k].sweep(spin, rng, totals);
+            if (iter >= ntherm && (iter + 1) % nskip == 0)
+            {
+                walker[k].measure(totals);
+            }
+        } });
+    for (int k = 1; k < nwalker; k++)
+    {
+        walker[0].merge(walker[k]);
+    }
+    const mcmc::Multicanonical<Lattice> &multicanonical = walker[0];
+
+    std::ofstream dosfile(dosname);
+    for (int b = 0; b < mcmc::WangLandau<Lattice>::nbin; b++)
+    {
+        if (multicanonical.samples(b) > 0)
+        {
+            const double bond = mcmc::WangLandau<Lattice>::bond(b);
+            dosfile << std::fixed << std::setprecision(4)
+                    << -coupling_J * bond / (nx * ny) << "   "
+                    << log_density[b] << "   "
+                    << multicanonical.log_density(b) << "   "
+                    << std::endl;
+        }
+    }
+    dosfile.close();
+
+    std::ofstream outputfile(outputname);
+    for (int conf = 0; conf < nconf + 1; conf++)
+    {
+        const mcmc::MulticanonicalEstimate estimate = multicanonical.at(t_start + conf * 0.001);
+        outputfile << std::fixed << std::setprecision(4)
+                   << estimate.temperature << "   "
+                   << estimate.order_parameter << "   "
+                   << estimate.binder_ratio << "   "
+                   << estimate.energy << "   "
+                   << estimate.specific_heat << "   "
+                   << std::endl;
+        if (conf % 10 == 0)
+        {
+            std::cout << std::fixed << std::setprecision(4)
+                      << estimate.temperature << "   "
+                      << estimate.order_parameter << "   "
+                      << estimate.binder_ratio << "   "
+                      << estimate.energy << "   "
+                      << estimate.specific_heat << "   "
+                      << std::endl;
+        }
+    }
+    outputfile.close();
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "../engine/spin_engine.hpp"
+#include "../engine/tempering.hpp"
+#include "../engine/statistics.hpp"
+const long int niter = 100000; // number of sweeps
+const int L = 32;
+const int nx = L; // number of sites along x-direction
+const int ny = L; // number of sites along y-direction
+const int Q = 5;  // first-order transition at T = 1 / ln(1 + sqrt(5)) = 0.8515
+const double coupling_J = 1.0;
+const int nconf = 20;
+const double t_start = 0.75;
+const int ntherm = 10000; // sweeps discarded before measuring
+const int nskip = 1;      // Frequency of measurement (sweeps)
+const int nexchange = 1;  // sweeps between rounds of temperature swaps
+const std::uint64_t seed = 0; // 0 -> fresh seed (recorded in seed_log.txt); otherwise rerun that seed
+
+using Lattice = mcmc::SquareLattice<mcmc::Potts<Q>, L>; // mcmc::Ising works as well
+using Update = mcmc::Metropolis<Lattice>;
+
+int main()
+{
+    std::vector<double> temperature(nconf + 1);
+    double sum = t_start;
+    for (int i = 0; i < nconf + 1; i++)
+    {
+        temperature[i] = sum;
+        sum += 0.01;
+        std::cout << temperature[i] << std::endl;
+    }
+    const std::uint64_t run_seed = mcmc::make_seed(seed);
+    std::cout << "seed " << run_seed << std::endl;
+    const std::string outputname = "../output/2d_Potts_L" + std::to_string(L) + "_q=" + std::to_string(Q) + "_parameter_exchange.txt";
+    const std::string swapname = "../output/2d_Potts_L" + std::to_string(L) + "_q=" + std::to_string(Q) + "_swap_exchange.txt";
+    // all temperatures at once, one replica per thread (build with -fopenmp)
+    mcmc::ReplicaExchange<Lattice, Update> tempering(temperature, coupling_J, 0e0, run_seed, [](const double T)
+                                                     { return Update(coupling_J, 0e0, T); });
+    for (int r = 0; r < nconf + 1; r++)
+    {
+        mcmc::log_seed(outputname, tempering.generator(r));
+    }
+
+    std::vector<mcmc::Jackknife<5>> moments(nconf + 1); // order parameter, m^2, m^4, E, E^2 at every temperature
+    for (long int iter = 0; iter != niter; iter++)
+    {
+        tempering.update_all([](Update &metropolis, Lattice &spin, mcmc::Xoshiro256ss &rng, mcmc::RunningTotals<Lattice::Model> *totals)
+                             { metropolis.sweep(spin, rng, totals); });
+        if ((iter + 1) % nexchange == 0)
+        {
+            tempering.exchange();
+        }
+        if (iter >= ntherm && (iter + 1) % nskip == 0)
+        {
+            for (int conf = 0; conf < nconf + 1; conf++)
+            {
+                const auto &totals = tempering.totals_at(conf);
+                double m2 = totals.squared_magnetization();
+                double energy = totals.energy(coupling_J);
+                moments[conf].add({mcmc::calc_order_parameter(totals), m2, m2 * m2, energy, energy * energy});
+            }
+        }
+    }
+
+    // T, order parameter, Binder ratio, E, C, then their errors
+    std::ofstream outputfile(outputname);
+    for (int conf = 0; conf < nconf + 1; conf++)
+    {
+        double T = temperature[conf];
+        mcmc::Estimate order_parameter = moments[conf].estimate(0);
+        mcmc::Estimate binder_ratio = moments[conf].estimate([](const auto &m)
+                                                             { return m[2] / m[1] / m[1]; });
+        mcmc::Estimate energy = moments[conf].estimate([](const auto &m)
+                                                       { return m[3] / (nx * ny); });
+        mcmc::Estimate specific_heat = moments[conf].estimate([T](const auto &m)
+                                                              { return (m[4] - m[3] * m[3]) / (T * T * nx * ny); });
+        std::cout << std::fixed << std::setprecision(4)
+                  << T << "   "
+                  << order_parameter.value << " +- " << order_parameter.error << "   "
+                  << binder_ratio.value << " +- " << binder_ratio.error << "   "
+                  << energy.value << " +- " << energy.error << "   "
+                  << specific_heat.value << " +- " << specific_heat.error << "   "
+                  << std::endl;
+        outputfile << std::fixed << std::setprecision(4)
+                   << T << "   "
+                   << order_parameter.value << "   "
+                   << binder_ratio.value << "   "
+                   << energy.value << "   "
+                   << specific_heat.value << "   "
+                   << order_parameter.error << "   "
+                   << binder_ratio.error << "   "
+                   << energy.error << "   "
+                   << specific_heat.error << "   "
+                   << std::endl;
+    }
+    outputfile.close();
+
+    // swap acceptance of every neighbouring pair; a pair near zero splits the grid in two
+    std::ofstream swapfile(swapname);
+    for (int conf = 0; conf < nconf; conf++)
+    {
+        std::cout << std::fixed << std::setprecision(4)
+                  << temperature[conf] << "   "
+                  << temperature[conf + 1] << "   "
+                  << tempering.acceptance(conf) << "   "
+                  << std::endl;
+        swapfile << std::fixed << std::setprecision(4)
+                 << temperature[conf] << "   "
+                 << temperature[conf + 1] << "   "
+                 << tempering.acceptance(conf) << "   "
+                 << std::endl;
+    }
+    swapfile.close();
+    return 0;
+}
@@ -1,7 +1,13 @@
 #include <iostream>
+#include <iomanip>
 #include <cmath>
 #include <fstream>
-const long int niter = 1000000;
+#include <string>
+#include <vector>
+#include "../engine/spin_engine.hpp"
+#include "../engine/schedule.hpp"
+#include "../engine/statistics.hpp"
+const long int niter = 1000000; // cap on cluster flips per temperature
 const int L = 128;
 const int nx = L; // number of sites along x-direction
 const int ny = L; // number of sites along y-direction
@@ -9,156 +15,12 @@ const int Q = 3;
 const double coupling_J = 1.0;
 const int nconf = 60;
 const double t_start = 0.7;
-const int nskip = 100;
+const double t_critical = 0.995; // runs near here are started first: 1 / ln(1 + sqrt(Q))
+const int ntherm = 100000; // cap on burn-in cluster flips; it ends earlier once the energy is stationary
+const double target_error = 0.01; // relative error on the order parameter at which a temperature stops
+const std::uint64_t seed = 0; // 0 -> fresh seed (recorded in seed_log.txt); otherwise rerun that seed
 
-double calc_energy(const int spin[nx][ny], const double coupling_J, const double temperature)
-{
-    double action = 0.0;
-    double sum = 0;
-    for (int ix = 0; ix != nx; ix++)
-    {
-        int ixp1 = (ix + 1) % nx;
-        for (int iy = 0; iy != ny; iy++)
-        {
-            int iyp1 = (iy + 1) % ny;
-            sum = sum + spin[ix][iy] * spin[ixp1][iy]
-                      + spin[ix][iy] * spin[ix][iyp1];
-        }
-    }
-    action = sum * coupling_J / temperature * (-1e0);
-
-    return action;
-}
-
-double calc_action(const int spin[nx][ny], const double coupling_J, const double temperature)
-{
-    double action = 0e0;
-    double sum = 0;
-    for (int ix = 0; ix != nx; ix++)
-    {
-        int ixp1 = (ix + 1) % nx;
-        for (int iy = 0; iy != ny; iy++)
-        {
-            int iyp1 = (iy + 1) % ny;
-            sum = sum + spin[ix][iy] * spin[ixp1][iy] + spin[ix][iy] * spin[ix][iyp1];
-        }
-    }
-    action = sum * coupling_J / temperature * (-1e0);
-
-    return action;
-}
-
-int calc_total_spin(const int spin[nx][ny])
-{
-    int total_spin = 0;
-    for (int ix = 0; ix != nx; ix++)
-    {
-        for (int iy = 0; iy != ny; iy++)
-        {
-            total_spin = total_spin + spin[ix][iy];
-        }
-    }
-    if(total_spin < 0)
-    {
-        total_spin = -total_spin;
-    }
-    return total_spin;
-}
-
-double calc_order_parameter(const double max_state_total_num)
-{
-    double order_parameter = (Q/(L*L)*max_state_total_num-1)/(Q-1);
-    return order_parameter;
-}
-
-int make_cluster(const int spin[nx][ny], const double coupling_J,
-                 const double temperature, int &n_cluster, int (&i_cluster)[nx * ny][2])
-{
-    int in_or_out[nx][ny];
-    for (int ix = 0; ix != nx; ix++)
-    {
-        for (int iy = 0; iy != ny; iy++)
-        {
-            in_or_out[ix][iy] = 1;
-        }
-    }
-    // in_or_out[ix][iy] = 1 -> not in the cluster; 0 -> in the cluster.
-    double rand_site = (double)rand() / RAND_MAX;
-    rand_site = rand_site * nx * ny;
-    int ix = (int)rand_site / ny;
-    int iy = (int)rand_site % ny;
-    in_or_out[ix][iy] = 0;
-    i_cluster[0][0] = ix;
-    i_cluster[0][1] = iy;
-    int spin_cluster = spin[ix][iy];
-    n_cluster = 1;
-    double probability = 1e0 - exp(-coupling_J / temperature);
-    int k = 0;
-    while (k < n_cluster)
-    {
-        ix = i_cluster[k][0];
-        iy = i_cluster[k][1];
-        int ixp1 = (ix + 1) % nx;
-        int iyp1 = (iy + 1) % ny;
-        int ixm1 = (ix - 1 + nx) % nx;
-        int iym1 = (iy - 1 + ny) % ny;
-
-        if (spin[ixp1][iy] == spin_cluster)
-        {
-            if (in_or_out[ixp1][iy] == 1)
-            {
-                if ((double)rand() / RAND_MAX < probability)
-                {
-                    i_cluster[n_cluster][0] = ixp1;
-                    i_cluster[n_cluster][1] = iy;
-                    n_cluster = n_cluster + 1;
-                    in_or_out[ixp1][iy] = 0;
-                }
-            }
-        }
-        if (spin[ix][iyp1] == spin_cluster)
-        {
-            if (in_or_out[ix][iyp1] == 1)
-            {
-                if ((double)rand() / RAND_MAX < probability)
-                {
-                    i_cluster[n_cluster][0] = ix;
-                    i_cluster[n_cluster][1] = iyp1;
-                    n_cluster = n_cluster + 1;
-                    in_or_out[ix][iyp1] = 0;
-                }
-            }
-        }
-        if (spin[ixm1][iy] == spin_cluster)
-        {
-            if (in_or_out[ixm1][iy] == 1)
-            {
-                if ((double)rand() / RAND_MAX < probability)
-                {
-                    i_cluster[n_cluster][0] = ixm1;
-                    i_cluster[n_cluster][1] = iy;
-                    n_cluster = n_cluster + 1;
-                    in_or_out[ixm1][iy] = 0;
-                }
-            }
-        }
-        if (spin[ix][iym1] == spin_cluster)
-        {
-            if (in_or_out[ix][iym1] == 1)
-            {
-                if ((double)rand() / RAND_MAX < probability)
-                {
-                    i_cluster[n_cluster][0] = ix;
-                    i_cluster[n_cluster][1] = iym1;
-                    n_cluster = n_cluster + 1;
-                    in_or_out[ix][iym1] = 0;
-                }
-            }
-        }
-        k = k + 1;
-    }
-    return spin_cluster;
-}
+using Lattice = mcmc::SquareLattice<mcmc::Potts<Q>, L>;
 
 int main()
 {
@@ -170,52 +32,75 @@ int main()
         sum += 0.01;
         std::cout << temperature[i] << std::endl;
     }
-    std::ofstream outputfile("../output/2d_Potts_L" + std::to_string(L) + "_parameter_wolff.txt");
+    const std::uint64_t run_seed = mcmc::make_seed(seed);
+    std::cout << "seed " << run_seed << std::endl;
+    const std::string outputname = "../output/2d_Potts_L" + std::to_string(L) + "_q=" + std::to_string(Q) + "_parameter_wolff.txt";
+    // temperatures run as independent tasks (build with -fopenmp); results are written in temperature order
+    std::vector<double> cost(nconf + 1);
     for (int conf = 0; conf < nconf + 1; conf++)
     {
+        cost[conf] = mcmc::critical_slowing_cost(temperature[conf], t_critical);
+    }
+    std::vector<mcmc::Estimate> result(nconf + 1);
+    std::vector<double> autocorrelation_time(nconf + 1);
+    std::vector<long int> stride(nconf + 1);
+    std::vector<long int> burn_in(nconf + 1);
+    mcmc::run_tasks(cost, [&](const int conf)
+                    {
         double T = temperature[conf];
-        int count = 0;
-        double total_spin_sum = 0;
-        double squared_total_spin_sum = 0;
-        double energy_sum = 0;
-        double squared_energy_sum = 0;
-        int spin[nx][ny];
-        srand((unsigned)time(NULL));
-        for (int ix = 0; ix != nx; ix++)
-        {
-            for (int iy = 0; iy != ny; iy++)
-            {
-                spin[ix][iy] = 1;
-            }
-        }
+        mcmc::Binning order_parameter_series;
+        mcmc::RunController controller; // measures every ~2 tau_int cluster flips
+        mcmc::Equilibration equilibration(ntherm); // MSER test on the energy
+        Lattice spin;
+        mcmc::Xoshiro256ss rng(run_seed, conf); // one stream per temperature
+        mcmc::log_seed(outputname, rng);
+        spin.fill(0);
+        mcmc::RunningTotals<Lattice::Model> totals(spin);
 
+        // p = 1 - exp(-J/T); every cluster moves to a random other state
+        mcmc::Wolff<Lattice> wolff(coupling_J, T);
         for (long int iter = 0; iter != niter; iter++)
         {
-            int n_cluster;
-            int i_cluster[nx * ny][2];
-            int spin_cluster = make_cluster(spin, coupling_J, T, n_cluster, i_cluster);
-            double metropolis = (double)rand() / RAND_MAX;
-            for (int k = 0; k != n_cluster; k++)
+            wolff.step(spin, rng, &totals);
+
+            if (!equilibration.equilibrated())
             {
-                int ix = i_cluster[k][0];
-                int iy = i_cluster[k][1];
-                spin[ix][iy] = -spin[ix][iy];
+                equilibration.add(totals.energy(coupling_J));
             }
-
-            if (iter > 100000 && (iter + 1) % nskip == 0)
+            else if (controller.tick())
             {
-                double max_state_total_num = ;
+                double order_parameter = mcmc::calc_order_parameter(totals);
+                order_parameter_series.add(order_parameter);
+                controller.record(order_parameter);
+                if (controller.check() && mcmc::within(order_parameter_series.estimate(), target_error))
+                {
+                    break;
+                }
             }
         }
 
-        double order_parameter = calc_order_parameter(max_state_total_num);
+        result[conf] = order_parameter_series.estimate();
+        autocorrelation_time[conf] = controller.autocorrelation_time();
+        stride[conf] = controller.get_stride();
+        burn_in[conf] = equilibration.burn_in(); });
+
+    // T, order parameter, its error
+    std::ofstream outputfile(outputname);
+    for (int conf = 0; conf < nconf + 1; conf++)
+    {
+        double T = temperature[conf];
+        double order_parameter = result[conf].value;
         std::cout << std::fixed << std::setprecision(4)
                   << T << "   "
-                  << order_parameter << "   "            
+                  << order_parameter << " +- " << result[conf].error << "   "
+                  << "tau_int " << autocorrelation_time[conf] << "   "
+                  << "stride " << stride[conf] << "   "
+                  << "burn-in " << burn_in[conf] << "   "
                   << std::endl;
         outputfile << std::fixed << std::setprecision(4)
                    << T << "   "
                    << order_parameter << "   "
+                   << result[conf].error << "   "
                    << std::endl;
     }
     outputfile.close();
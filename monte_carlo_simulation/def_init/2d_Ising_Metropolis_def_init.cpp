@@ -1,171 +1,39 @@
 #include <iostream>
 #include <cmath>
 #include <fstream>
+#include "../engine/spin_engine.hpp"
 const long int monte_carlo_step = 100000;
 const int L = 64;
 const int nx = L; // number of sites along x-direction
 const int ny = L; // number of sites along y-direction
-const int niter = monte_carlo_step * nx * ny;
 const double coupling_J = 1.0;
 const double coupling_h = 0;
 const double temperature = 5.0;
 const int nconfig = 1;
-const int nskip = nx * ny * 100; // Frequency of measurement
+const std::uint64_t seed = 0; // 0 -> fresh seed (recorded in seed_log.txt); otherwise rerun that seed
 
-double calc_action(const int spin[nx][ny], const double coupling_J, const double coupling_h, const double temperature)
-{
-
-    double action = 0e0;
-    int sum1 = 0;
-    int sum2 = 0;
-    for (int ix = 0; ix != nx; ix++)
-    {
-        int ixp1 = (ix + 1) % nx; // ixp1=ix+1; be careful about the boundary condition.
-        for (int iy = 0; iy != ny; iy++)
-        {
-            int iyp1 = (iy + 1) % ny; // iyp1=iy+1; be careful about the boundary condition.
-            sum1 = sum1 + spin[ix][iy];
-            sum2 = sum2 + spin[ix][iy] * spin[ixp1][iy] + spin[ix][iy] * spin[ix][iyp1];
-        }
-    }
-    action = (sum2 * coupling_J + sum1 * coupling_h) / temperature * (-1e0);
-
-    return action;
-}
-/***********************************************/
-/*** Calculation of the change of the action ***/
-/***  when the spin at (ix,iy) is flipped    ***/
-/***********************************************/
-double calc_action_change(const int spin[nx][ny], const double coupling_J, const double coupling_h, const double temperature, const int ix, const int iy)
-{
-
-    double action_change = 0e0;
-    //  int sum1_change=0;
-    // int sum2_change=0;
-
-    int ixp1 = (ix + 1) % nx;      // ixp1=ix+1; be careful about the boundary condition.
-    int iyp1 = (iy + 1) % ny;      // iyp1=iy+1; be careful about the boundary condition.
-    int ixm1 = (ix - 1 + nx) % nx; // ixm1=ix-1; be careful about the boundary condition.
-    int iym1 = (iy - 1 + ny) % ny; // iym1=iy-1; be careful about the boundary condition.
-
-    int sum1_change = 2 * spin[ix][iy];
-    int sum2_change = 2 * spin[ix][iy] * spin[ixp1][iy] + 2 * spin[ix][iy] * spin[ix][iyp1] + 2 * spin[ix][iy] * spin[ixm1][iy] + 2 * spin[ix][iy] * spin[ix][iym1];
-
-    action_change = (sum2_change * coupling_J + sum1_change * coupling_h) / temperature;
-
-    return action_change;
-}
-/*************************************/
-/*** Calculation of the total spin ***/
-/*************************************/
-int calc_total_spin(const int spin[nx][ny])
-{
+using Lattice = mcmc::SquareLattice<mcmc::Ising, L>;
 
-    int total_spin = 0;
-
-    for (int ix = 0; ix != nx; ix++)
-    {
-        for (int iy = 0; iy != ny; iy++)
-        {
-            total_spin = total_spin + spin[ix][iy];
-        }
-    }
-
-    return total_spin;
-}
 /************/
 /*** Main ***/
 /************/
 int main()
 {
-    int spin[nx][ny];
-    srand((unsigned)time(NULL));
+    Lattice spin;
+    mcmc::Xoshiro256ss rng(mcmc::make_seed(seed));
+    std::cout << "seed " << rng.seed() << std::endl;
     /*********************************/
     /* Set the initial configuration */
     /*********************************/
-    if (nconfig == 1)
-    {
-        for (int ix = 0; ix != nx; ix++)
-        {
-            for (int iy = 0; iy != ny; iy++)
-            {
-                spin[ix][iy] = 1;
-            }
-        }
-    }
-    if (nconfig == -1)
-    {
-        for (int ix = 0; ix != nx; ix++)
-        {
-            for (int iy = 0; iy != ny; iy++)
-            {
-                spin[ix][iy] = -1;
-            }
-        }
-    }
-    if (nconfig == 0)
-    {
-        std::ifstream inputconfig("input_config.txt");
-        if (!inputconfig)
-        {
-            std::cout << "inputfile not found" << std::endl;
-            exit(1);
-        }
-        for (int ix = 0; ix != nx; ix++)
-        {
-            for (int iy = 0; iy != ny; iy++)
-            {
-                inputconfig >> ix >> iy >> spin[ix][iy];
-            }
-        }
-        inputconfig.close();
-    }
-    // std::ofstream outputfile("output.txt");
-    int naccept = 0; // counter for the number of acceptance
+    mcmc::init_config(spin, nconfig, "input_config.txt");
+    mcmc::Metropolis<Lattice> metropolis(coupling_J, coupling_h, temperature);
 
-    for (long int iter = 0; iter != niter; iter++)
-    {
-        // choose a point randomly.
-        double rand_site = (double)rand() / RAND_MAX;
-        rand_site = rand_site * nx * ny;
-        int ix = (int)rand_site / ny;
-        int iy = (int)rand_site % ny;
-        double metropolis = (double)rand() / RAND_MAX;
-        double action_change = calc_action_change(spin, coupling_J, coupling_h, temperature, ix, iy);
-        if (exp(-action_change) > metropolis)
-        {
-            // accept
-            spin[ix][iy] = -spin[ix][iy];
-            naccept = naccept + 1;
-        }
-        else
-        {
-            // reject
-        }
-        // int total_spin = calc_total_spin(spin);
-        // double energy = calc_action(spin, coupling_J, coupling_h, temperature) * temperature;
-        // if ((iter + 1) % nskip == 0)
-        // {
-        //     std::cout << std::fixed << std::setprecision(4)
-        //               << total_spin << "   "
-        //               << energy << "   "
-        //               << (double)naccept / (iter + 1) << std::endl;
-        //     outputfile << std::fixed << std::setprecision(4)
-        //                << total_spin << "   "
-        //                << energy << "   "
-        //                << (double)naccept / (iter + 1) << std::endl;
-        // }
-    }
-    // outputfile.close();
-    std::ofstream outputconfig("../output/2d_Ising_output_config.txt");
-    for (int ix = 0; ix != nx; ix++)
+    for (long int iter = 0; iter != monte_carlo_step; iter++)
     {
-        for (int iy = 0; iy != ny; iy++)
-        {
-            outputconfig << ix << ' ' << iy << ' ' << spin[ix][iy]
-                         << ' ' << std::endl;
-        }
+        metropolis.sweep(spin, rng);
     }
-    outputconfig.close();
+    const std::string filename = "../output/2d_Ising_output_config.txt";
+    mcmc::write_config(filename, spin);
+    mcmc::log_seed(filename, rng);
     return 0;
 }
@@ -0,0 +1,207 @@
+#ifndef MCMC_ACCEPTANCE_HPP
+#define MCMC_ACCEPTANCE_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace mcmc
+{
+    /*** 31-bit fixed-point threshold: accept iff (next_u32() >> 1) <= threshold ***/
+    inline std::int32_t acceptance_threshold(const double probability)
+    {
+        if (probability >= 1e0)
+        {
+            return 0x7fffffff;
+        }
+        return (std::int32_t)std::ceil(probability * 2147483648.0) - 1;
+    }
+
+    template <class Rng>
+    bool accept(Rng &rng, const std::int32_t threshold)
+    {
+        return (std::int32_t)(rng.next_u32() >> 1) <= threshold;
+    }
+
+    /**********************************************************************/
+    /*** Local field of a site = multiset of its four neighbour states ***/
+    /*** The sorted states n0 <= n1 <= n2 <= n3 are ranked with the     ***/
+    /*** combinatorial number system, c_k = n_k + k:                    ***/
+    /***   field = C(c0,1) + C(c1,2) + C(c2,3) + C(c3,4)                ***/
+    /*** which gives C(Q+3,4) fields (5 for Ising, 126 for Q = 6).      ***/
+    /**********************************************************************/
+    template <int Q>
+    struct LocalField
+    {
+        static constexpr long binomial(const int n, const int k)
+        {
+            long c = 1;
+            for (int j = 0; j < k; j++)
+            {
+                c = c * (n - j) / (j + 1);
+            }
+            return n < k ? 0 : c;
+        }
+
+        static constexpr int nfield = (int)binomial(Q + 3, 4);
+
+        static int index(const int (&n)[4])
+        {
+            if (Q == 2)
+            {
+                return n[0] + n[1] + n[2] + n[3];
+            }
+            // sorting network for four values
+            int a = n[0], b = n[1], c = n[2], d = n[3];
+            sort2(a, b);
+            sort2(c, d);
+            sort2(a, c);
+            sort2(b, d);
+            sort2(b, c);
+            return a + binomial_table[1][b + 1] + binomial_table[2][c + 2] + binomial_table[3][d + 3];
+        }
+
+        // C(c, k + 1) for c = 0..Q+2; the vector kernels gather from these rows
+        static constexpr const int *binomial_row(const int k) { return binomial_table[k]; }
+
+        // visits every field once with a representative neighbour tuple
+        template <class Function>
+        static void for_each(Function function)
+        {
+            int n[4];
+            for (n[0] = 0; n[0] != Q; n[0]++)
+            {
+                for (n[1] = n[0]; n[1] != Q; n[1]++)
+                {
+                    for (n[2] = n[1]; n[2] != Q; n[2]++)
+                    {
+                        for (n[3] = n[2]; n[3] != Q; n[3]++)
+                        {
+                            function(index(n), n);
+                        }
+                    }
+                }
+            }
+        }
+
+    private:
+        static void sort2(int &a, int &b)
+        {
+            const int lo = a < b ? a : b;
+            const int hi = a < b ? b : a;
+            a = lo;
+            b = hi;
+        }
+
+        struct BinomialTable
+        {
+            int value[4][Q + 3];
+            constexpr BinomialTable() : value()
+            {
+                for (int k = 0; k != 4; k++)
+                {
+                    for (int c = 0; c != Q + 3; c++)
+                    {
+                        value[k][c] = (int)binomial(c, k + 1);
+                    }
+                }
+            }
+            constexpr const int *operator[](const int k) const { return value[k]; }
+        };
+        static constexpr BinomialTable binomial_table{};
+    };
+
+    /**************************************************************/
+    /*** Metropolis acceptance per (field, old state, new state) ***/
+    /**************************************************************/
+    template <class Model>
+    class MetropolisTable
+    {
+    public:
+        static constexpr int Q = Model::Q;
+        using Field = LocalField<Q>;
+
+        MetropolisTable() : threshold(Field::nfield * Q * Q) {}
+
+        void build(const double coupling_J, const double coupling_h, const double temperature)
+        {
+            Field::for_each([&](const int field, const int (&n)[4])
+                            {
+                for (int a = 0; a != Q; a++)
+                {
+                    for (int b = 0; b != Q; b++)
+                    {
+                        double sum_change = 0e0;
+                        for (int k = 0; k != 4; k++)
+                        {
+                            sum_change += Model::bond(a, n[k]) - Model::bond(b, n[k]);
+                        }
+                        const double site_change = Model::site(a) - Model::site(b);
+                        const double action_change = (sum_change * coupling_J + site_change * coupling_h) / temperature;
+                        threshold[(field * Q + a) * Q + b] = acceptance_threshold(std::exp(-action_change));
+                    }
+                } });
+        }
+
+        std::int32_t operator()(const int field, const int a, const int b) const { return threshold[(field * Q + a) * Q + b]; }
+        const std::int32_t *data() const { return threshold.data(); }
+
+    private:
+        std::vector<std::int32_t> threshold;
+    };
+
+    /****************************************************************/
+    /*** Heat-bath cumulative distribution per field: the new     ***/
+    /*** state is the first a with (next_u32() >> 1) <= cum[a]    ***/
+    /****************************************************************/
+    template <class Model>
+    class HeatBathTable
+    {
+    public:
+        static constexpr int Q = Model::Q;
+        using Field = LocalField<Q>;
+
+        HeatBathTable() : cumulative(Field::nfield * Q) {}
+
+        void build(const double coupling_J, const double coupling_h, const double temperature)
+        {
+            Field::for_each([&](const int field, const int (&n)[4])
+                            {
+                double ratio[Q];
+                double norm = 0e0;
+                for (int a = 0; a != Q; a++)
+                {
+                    double temp = coupling_h * Model::site(a);
+                    for (int k = 0; k != 4; k++)
+                    {
+                        temp += coupling_J * Model::bond(a, n[k]);
+                    }
+                    ratio[a] = temp / temperature;
+                }
+                // subtract the largest exponent so nothing overflows at low T
+                double largest = ratio[0];
+                for (int a = 1; a != Q; a++)
+                {
+                    largest = ratio[a] > largest ? ratio[a] : largest;
+                }
+                for (int a = 0; a != Q; a++)
+                {
+                    ratio[a] = std::exp(ratio[a] - largest);
+                    norm += ratio[a];
+                }
+                double sum = 0e0;
+                for (int a = 0; a != Q; a++)
+                {
+                    sum += ratio[a] / norm;
+                    cumulative[field * Q + a] = a == Q - 1 ? 0x7fffffff : acceptance_threshold(sum);
+                } });
+        }
+
+        const std::int32_t *operator[](const int field) const { return cumulative.data() + field * Q; }
+
+    private:
+        std::vector<std::int32_t> cumulative;
+    };
+}
+
+#endif
@@ -0,0 +1,575 @@
+#ifndef MCMC_CHECKERBOARD_HPP
+#define MCMC_CHECKERBOARD_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+#include "spin_models.hpp"
+#include "lattice.hpp"
+#include "acceptance.hpp"
+
+namespace mcmc
+{
+    /************************************************************/
+    /*** Ising lattice split into its two checkerboard colours ***/
+    /***   colour c = (ix + iy) % 2                            ***/
+    /***   row ix of colour c holds iy = 2 j + ((c ^ ix) & 1)  ***/
+    /*** one int8 spin (+1/-1) per site, nx rows of ny/2 each  ***/
+    /************************************************************/
+    template <int L_>
+    class CheckerboardIsing
+    {
+    public:
+        static_assert(L_ % 2 == 0, "checkerboard needs an even L");
+        using Model = Ising;
+        static constexpr int L = L_;
+        static constexpr int nx = L; // number of sites along x-direction
+        static constexpr int ny = L; // number of sites along y-direction
+        static constexpr int nsite = nx * ny;
+        static constexpr int nhalf = ny / 2; // sites per row and colour
+
+        CheckerboardIsing() : sub{std::vector<std::int8_t>(nsite / 2, 1), std::vector<std::int8_t>(nsite / 2, 1)} {}
+
+        /*** same site numbering as SquareLattice ***/
+        static constexpr int index(const int ix, const int iy) { return ix * ny + iy; }
+        static constexpr int xp(const int i) { return index((i / ny + 1) % nx, i % ny); }
+        static constexpr int xm(const int i) { return index((i / ny - 1 + nx) % nx, i % ny); }
+        static constexpr int yp(const int i) { return index(i / ny, (i % ny + 1) % ny); }
+        static constexpr int ym(const int i) { return index(i / ny, (i % ny - 1 + ny) % ny); }
+
+        int operator[](const int i) const { return Model::state(value(i / ny, i % ny)); }
+        int operator()(const int ix, const int iy) const { return Model::state(value(ix, iy)); }
+        void set(const int i, const int state) { value(i / ny, i % ny) = (std::int8_t)Model::value(state); }
+
+        void neighbour_states(const int i, int (&n)[4]) const
+        {
+            n[0] = (*this)[xp(i)];
+            n[1] = (*this)[yp(i)];
+            n[2] = (*this)[xm(i)];
+            n[3] = (*this)[ym(i)];
+        }
+
+        void fill(const int state)
+        {
+            for (int c = 0; c != 2; c++)
+            {
+                for (std::int8_t &s : sub[c])
+                {
+                    s = (std::int8_t)Model::value(state);
+                }
+            }
+        }
+
+        // row ix of colour c
+        std::int8_t *row(const int c, const int ix) { return sub[c].data() + ix * nhalf; }
+        const std::int8_t *row(const int c, const int ix) const { return sub[c].data() + ix * nhalf; }
+        void refresh() {} // no ghost cells
+
+    private:
+        std::int8_t &value(const int ix, const int iy) { return sub[(ix + iy) & 1][ix * nhalf + iy / 2]; }
+        std::int8_t value(const int ix, const int iy) const { return sub[(ix + iy) & 1][ix * nhalf + iy / 2]; }
+
+        std::vector<std::int8_t> sub[2];
+    };
+
+    /**************************************************************/
+    /*** Checkerboard Metropolis sweep for the Ising model       ***/
+    /*** all sites of one colour are updated together; the      ***/
+    /*** acceptance min(1, exp(-dE/T)) is a 31-bit threshold     ***/
+    /*** indexed by (spin, s * neighbour sum), so the kernels    ***/
+    /*** only compare random integers (AVX-512 / AVX2 / scalar)  ***/
+    /**************************************************************/
+    template <int L>
+    class CheckerboardMetropolis
+    {
+    public:
+        using Lattice = CheckerboardIsing<L>;
+        static constexpr int nhalf = Lattice::nhalf;
+        static constexpr int nrandom = nhalf;   // random numbers per row
+        static constexpr int row_bytes = nhalf; // bytes per row of one colour
+
+        CheckerboardMetropolis(const double coupling_J, const double coupling_h, const double temperature)
+            : coupling_J(coupling_J), coupling_h(coupling_h), random(nrandom)
+        {
+            set_temperature(temperature);
+        }
+
+        void set_temperature(const double T)
+        {
+            temperature = T;
+            // index = 5 * (s < 0) + (s * sum + 4) / 2, dE = 2 J s sum + 2 h s
+            for (int is = 0; is != 2; is++)
+            {
+                const int s = 1 - 2 * is;
+                for (int k = 0; k != 5; k++)
+                {
+                    const int s_sum = 2 * k - 4;
+                    const double energy_change = 2e0 * coupling_J * s_sum + 2e0 * coupling_h * s;
+                    threshold[5 * is + k] = acceptance_threshold(std::exp(-energy_change / temperature));
+                }
+            }
+            for (int k = 10; k != 16; k++)
+            {
+                threshold[k] = 0;
+            }
+        }
+        double get_temperature() const { return temperature; }
+
+        // one update of every site: colour 0, then colour 1
+        template <class Rng>
+        void sweep(Lattice &spin, Rng &rng)
+        {
+            half_sweep(spin, rng, 0);
+            half_sweep(spin, rng, 1);
+        }
+
+        template <class Rng>
+        void half_sweep(Lattice &spin, Rng &rng, const int c)
+        {
+            for (int ix = 0; ix != L; ix++)
+            {
+                rng.fill(random.data(), nrandom);
+                update_row(spin, c, ix, random.data());
+            }
+        }
+
+        void update_row(Lattice &spin, const int c, const int ix, const std::uint32_t *r) const
+        {
+            std::int8_t *s = spin.row(c, ix);
+            const std::int8_t *up = spin.row(c ^ 1, (ix - 1 + L) % L);
+            const std::int8_t *down = spin.row(c ^ 1, (ix + 1) % L);
+            const std::int8_t *mid = spin.row(c ^ 1, ix);
+            // iy = 2 j + offset; the partner of mid[j] is mid[j - 1] or mid[j + 1]
+            const int offset = (c ^ ix) & 1;
+            const int shift = offset ? 1 : -1;
+            // the one site whose partner wraps around the row is done in scalar code
+            const int jedge = offset ? nhalf - 1 : 0;
+            const int jbegin = offset ? 0 : 1;
+            const int jend = offset ? nhalf - 1 : nhalf;
+
+            update_site(s, up, down, mid, jedge, (jedge + shift + nhalf) % nhalf, r);
+            int j = jbegin;
+#if defined(__AVX512F__)
+            const __m512i table = _mm512_loadu_si512(threshold);
+            for (; j + 16 <= jend; j += 16)
+            {
+                __m512i sv = _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(s + j)));
+                __m512i sum = _mm512_add_epi32(
+                    _mm512_add_epi32(_mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(up + j))),
+                                     _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(down + j)))),
+                    _mm512_add_epi32(_mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(mid + j))),
+                                     _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(mid + j + shift)))));
+                __m512i s_sum = _mm512_mullo_epi32(sv, sum);
+                __m512i index = _mm512_srai_epi32(_mm512_add_epi32(s_sum, _mm512_set1_epi32(4)), 1);
+                __mmask16 negative = _mm512_cmplt_epi32_mask(sv, _mm512_setzero_si512());
+                index = _mm512_mask_add_epi32(index, negative, index, _mm512_set1_epi32(5));
+                __m512i thr = _mm512_permutexvar_epi32(index, table);
+                __m512i rv = _mm512_srli_epi32(_mm512_loadu_si512(r + j), 1);
+                __mmask16 accept = _mm512_cmple_epi32_mask(rv, thr);
+                sv = _mm512_mask_sub_epi32(sv, accept, _mm512_setzero_si512(), sv);
+                _mm_storeu_si128((__m128i *)(s + j), _mm512_cvtepi32_epi8(sv));
+            }
+#endif
+#if defined(__AVX2__)
+            const __m256i table_lo = _mm256_loadu_si256((const __m256i *)threshold);
+            const __m256i table_hi = _mm256_loadu_si256((const __m256i *)(threshold + 8));
+            for (; j + 8 <= jend; j += 8)
+            {
+                __m256i sv = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(s + j)));
+                __m256i sum = _mm256_add_epi32(
+                    _mm256_add_epi32(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(up + j))),
+                                     _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(down + j)))),
+                    _mm256_add_epi32(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(mid + j))),
+                                     _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(mid + j + shift)))));
+                __m256i s_sum = _mm256_sign_epi32(sum, sv);
+                __m256i index = _mm256_srai_epi32(_mm256_add_epi32(s_sum, _mm256_set1_epi32(4)), 1);
+                __m256i negative = _mm256_cmpgt_epi32(_mm256_setzero_si256(), sv);
+                index = _mm256_add_epi32(index, _mm256_and_si256(negative, _mm256_set1_epi32(5)));
+                __m256i thr = _mm256_blendv_epi8(_mm256_permutevar8x32_epi32(table_lo, index),
+                                                 _mm256_permutevar8x32_epi32(table_hi, index),
+                                                 _mm256_cmpgt_epi32(index, _mm256_set1_epi32(7)));
+                __m256i rv = _mm256_srli_epi32(_mm256_loadu_si256((const __m256i *)(r + j)), 1);
+                __m256i accept = _mm256_andnot_si256(_mm256_cmpgt_epi32(rv, thr), _mm256_set1_epi32(-1));
+                sv = _mm256_sub_epi32(sv, _mm256_and_si256(accept, _mm256_add_epi32(sv, sv)));
+                // narrow 8 x int32 -> 8 x int8
+                __m256i p16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(sv, sv), 0x08);
+                __m128i p8 = _mm_packs_epi16(_mm256_castsi256_si128(p16), _mm256_castsi256_si128(p16));
+                _mm_storel_epi64((__m128i *)(s + j), p8);
+            }
+#endif
+            for (; j < jend; j++)
+            {
+                update_site(s, up, down, mid, j, j + shift, r);
+            }
+        }
+
+    private:
+        void update_site(std::int8_t *s, const std::int8_t *up, const std::int8_t *down, const std::int8_t *mid,
+                         const int j, const int jpartner, const std::uint32_t *r) const
+        {
+            const int sum = up[j] + down[j] + mid[j] + mid[jpartner];
+            const int index = 5 * (s[j] < 0) + (s[j] * sum + 4) / 2;
+            if ((std::int32_t)(r[j] >> 1) <= threshold[index])
+            {
+                s[j] = -s[j]; // flip
+            }
+        }
+
+        double coupling_J;
+        double coupling_h;
+        double temperature = 1e0;
+        alignas(64) std::int32_t threshold[16];
+        std::vector<std::uint32_t> random;
+    };
+
+    /**************************************************************/
+    /*** Checkerboard heat-bath sweep for the Ising model         ***/
+    /*** the new spin does not depend on the old one: it is +1    ***/
+    /*** iff a random integer is below the 31-bit threshold of    ***/
+    /*** 1 / (1 + exp(-2 (J sum + h) / T)), one per neighbour sum ***/
+    /*** (AVX-512 / AVX2 / scalar)                                ***/
+    /**************************************************************/
+    template <int L>
+    class CheckerboardHeatBath
+    {
+    public:
+        using Lattice = CheckerboardIsing<L>;
+        static constexpr int nhalf = Lattice::nhalf;
+        static constexpr int nrandom = nhalf;   // random numbers per row
+        static constexpr int row_bytes = nhalf; // bytes per row of one colour
+
+        CheckerboardHeatBath(const double coupling_J, const double coupling_h, const double temperature)
+            : coupling_J(coupling_J), coupling_h(coupling_h), random(nrandom)
+        {
+            set_temperature(temperature);
+        }
+
+        void set_temperature(const double T)
+        {
+            temperature = T;
+            // index = (sum + 4) / 2
+            for (int k = 0; k != 5; k++)
+            {
+                const int sum = 2 * k - 4;
+                const double field = coupling_J * sum + coupling_h;
+                threshold[k] = acceptance_threshold(1e0 / (1e0 + std::exp(-2e0 * field / temperature)));
+            }
+            for (int k = 5; k != 16; k++)
+            {
+                threshold[k] = 0;
+            }
+        }
+        double get_temperature() const { return temperature; }
+
+        // one update of every site: colour 0, then colour 1
+        template <class Rng>
+        void sweep(Lattice &spin, Rng &rng)
+        {
+            half_sweep(spin, rng, 0);
+            half_sweep(spin, rng, 1);
+        }
+
+        template <class Rng>
+        void half_sweep(Lattice &spin, Rng &rng, const int c)
+        {
+            for (int ix = 0; ix != L; ix++)
+            {
+                rng.fill(random.data(), nrandom);
+                update_row(spin, c, ix, random.data());
+            }
+        }
+
+        void update_row(Lattice &spin, const int c, const int ix, const std::uint32_t *r) const
+        {
+            std::int8_t *s = spin.row(c, ix);
+            const std::int8_t *up = spin.row(c ^ 1, (ix - 1 + L) % L);
+            const std::int8_t *down = spin.row(c ^ 1, (ix + 1) % L);
+            const std::int8_t *mid = spin.row(c ^ 1, ix);
+            // same row geometry as CheckerboardMetropolis::update_row
+            const int offset = (c ^ ix) & 1;
+            const int shift = offset ? 1 : -1;
+            const int jedge = offset ? nhalf - 1 : 0;
+            const int jbegin = offset ? 0 : 1;
+            const int jend = offset ? nhalf - 1 : nhalf;
+
+            update_site(s, up, down, mid, jedge, (jedge + shift + nhalf) % nhalf, r);
+            int j = jbegin;
+#if defined(__AVX512F__)
+            const __m512i table = _mm512_loadu_si512(threshold);
+            for (; j + 16 <= jend; j += 16)
+            {
+                __m512i sum = _mm512_add_epi32(
+                    _mm512_add_epi32(_mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(up + j))),
+                                     _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(down + j)))),
+                    _mm512_add_epi32(_mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(mid + j))),
+                                     _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(mid + j + shift)))));
+                __m512i index = _mm512_srai_epi32(_mm512_add_epi32(sum, _mm512_set1_epi32(4)), 1);
+                __m512i thr = _mm512_permutexvar_epi32(index, table);
+                __m512i rv = _mm512_srli_epi32(_mm512_loadu_si512(r + j), 1);
+                __mmask16 plus = _mm512_cmple_epi32_mask(rv, thr);
+                __m512i sv = _mm512_mask_blend_epi32(plus, _mm512_set1_epi32(-1), _mm512_set1_epi32(1));
+                _mm_storeu_si128((__m128i *)(s + j), _mm512_cvtepi32_epi8(sv));
+            }
+#endif
+#if defined(__AVX2__)
+            const __m256i table_lo = _mm256_loadu_si256((const __m256i *)threshold);
+            for (; j + 8 <= jend; j += 8)
+            {
+                __m256i sum = _mm256_add_epi32(
+                    _mm256_add_epi32(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(up + j))),
+                                     _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(down + j)))),
+                    _mm256_add_epi32(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(mid + j))),
+                                     _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(mid + j + shift)))));
+                __m256i index = _mm256_srai_epi32(_mm256_add_epi32(sum, _mm256_set1_epi32(4)), 1);
+                __m256i thr = _mm256_permutevar8x32_epi32(table_lo, index);
+                __m256i rv = _mm256_srli_epi32(_mm256_loadu_si256((const __m256i *)(r + j)), 1);
+                // +1 where rv <= thr, -1 elsewhere
+                __m256i minus = _mm256_cmpgt_epi32(rv, thr);
+                __m256i sv = _mm256_or_si256(minus, _mm256_set1_epi32(1));
+                // narrow 8 x int32 -> 8 x int8
+                __m256i p16 = _mm256_permute4x64_epi64(_mm256_packs_epi32(sv, sv), 0x08);
+                __m128i p8 = _mm_packs_epi16(_mm256_castsi256_si128(p16), _mm256_castsi256_si128(p16));
+                _mm_storel_epi64((__m128i *)(s + j), p8);
+            }
+#endif
+            for (; j < jend; j++)
+            {
+                update_site(s, up, down, mid, j, j + shift, r);
+            }
+        }
+
+    private:
+        void update_site(std::int8_t *s, const std::int8_t *up, const std::int8_t *down, const std::int8_t *mid,
+                         const int j, const int jpartner, const std::uint32_t *r) const
+        {
+            const int sum = up[j] + down[j] + mid[j] + mid[jpartner];
+            s[j] = (std::int32_t)(r[j] >> 1) <= threshold[(sum + 4) / 2] ? 1 : -1;
+        }
+
+        double coupling_J;
+        double coupling_h;
+        double temperature = 1e0;
+        alignas(64) std::int32_t threshold[16];
+        std::vector<std::uint32_t> random;
+    };
+
+    /******************************************************************/
+    /*** Checkerboard Metropolis sweep for Q-state models (Potts,    ***/
+    /*** Clock) on a SquareLattice. The sites of one colour in a row ***/
+    /*** are taken eight at a time: the four neighbour rows are      ***/
+    /*** loaded together, the local field is ranked with a vector    ***/
+    /*** sorting network and the acceptance threshold is gathered    ***/
+    /*** from the (field, old, new) table (AVX2 / scalar). Needs     ***/
+    /*** IntStorage or ByteStorage.                                  ***/
+    /******************************************************************/
+    template <class Lattice_>
+    class QStateCheckerboardMetropolis
+    {
+    public:
+        using Lattice = Lattice_;
+        using Model = typename Lattice::Model;
+        using Field = LocalField<Model::Q>;
+        static constexpr int Q = Model::Q;
+        static constexpr int L = Lattice::L;
+        static constexpr int nhalf = L / 2; // sites per row and colour
+        static_assert(L % 2 == 0, "checkerboard needs an even L");
+        using value_type = typename Lattice::Storage::value_type; // int or uint8_t
+        static constexpr int nrandom = 2 * nhalf; // random numbers per row
+        static constexpr int row_bytes = Lattice::Layout::row_stride * (int)sizeof(value_type);
+
+        QStateCheckerboardMetropolis(const double coupling_J, const double coupling_h, const double temperature)
+            : coupling_J(coupling_J), coupling_h(coupling_h), random(nrandom)
+        {
+            set_temperature(temperature);
+        }
+
+        void set_temperature(const double T)
+        {
+            temperature = T;
+            table.build(coupling_J, coupling_h, temperature);
+        }
+        double get_temperature() const { return temperature; }
+
+        // one update of every site: colour 0, then colour 1
+        template <class Rng>
+        void sweep(Lattice &spin, Rng &rng)
+        {
+            half_sweep(spin, rng, 0);
+            half_sweep(spin, rng, 1);
+        }
+
+        template <class Rng>
+        void half_sweep(Lattice &spin, Rng &rng, const int c)
+        {
+            for (int ix = 0; ix != L; ix++)
+            {
+                rng.fill(random.data(), nrandom);
+                update_row(spin, c, ix, random.data());
+            }
+            spin.refresh();
+        }
+
+        // sites iy = 2 j + offset of row ix; r[j] picks the proposal, r[nhalf + j] accepts it
+        void update_row(Lattice &spin, const int c, const int ix, const std::uint32_t *r) const
+        {
+            value_type *s = spin.row(ix);
+            const value_type *up = spin.row((ix - 1 + L) % L);
+            const value_type *down = spin.row((ix + 1) % L);
+            const int offset = (c ^ ix) & 1;
+            // the one site whose left or right neighbour wraps around the row is done in scalar code
+            const int jedge = offset ? nhalf - 1 : 0;
+            const int jbegin = offset ? 0 : 1;
+            const int jend = offset ? nhalf - 1 : nhalf;
+
+            update_site(s, up, down, offset, jedge, r);
+            int j = jbegin;
+#if defined(__AVX2__)
+            const __m256i rotate = _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6);
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256i qv = _mm256_set1_epi32(Q);
+            for (; j + 8 <= jend; j += 8)
+            {
+                const int iy = 2 * j + offset;
+                // sixteen sites of row ix: colour c in the even lanes, their +y neighbours in the odd lanes
+                __m256i lo, hi;
+                load16(s + iy, lo, hi);
+                __m256i a, n[4];
+                split(lo, hi, a, n[1]);
+                n[3] = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(n[1], rotate), _mm256_set1_epi32(s[iy - 1]), 0x01);
+                n[0] = even_lanes(up + iy);
+                n[2] = even_lanes(down + iy);
+
+                __m256i field;
+                if (Q == 2)
+                {
+                    field = _mm256_add_epi32(_mm256_add_epi32(n[0], n[1]), _mm256_add_epi32(n[2], n[3]));
+                }
+                else
+                {
+                    sort2(n[0], n[1]);
+                    sort2(n[2], n[3]);
+                    sort2(n[0], n[2]);
+                    sort2(n[1], n[3]);
+                    sort2(n[1], n[2]);
+                    // n0 + C(n1 + 1, 2) + C(n2 + 2, 3) + C(n3 + 3, 4)
+                    const __m256i c1 = _mm256_srli_epi32(_mm256_mullo_epi32(n[1], _mm256_add_epi32(n[1], one)), 1);
+                    const __m256i c2 = _mm256_i32gather_epi32(Field::binomial_row(2), _mm256_add_epi32(n[2], _mm256_set1_epi32(2)), 4);
+                    const __m256i c3 = _mm256_i32gather_epi32(Field::binomial_row(3), _mm256_add_epi32(n[3], _mm256_set1_epi32(3)), 4);
+                    field = _mm256_add_epi32(_mm256_add_epi32(n[0], c1), _mm256_add_epi32(c2, c3));
+                }
+
+                __m256i b;
+                if (flip)
+                {
+                    b = _mm256_xor_si256(a, one);
+                }
+                else
+                {
+                    // (r * Q) >> 32 in every lane
+                    const __m256i rv = _mm256_loadu_si256((const __m256i *)(r + j));
+                    const __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(rv, qv), 32);
+                    const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(rv, 32), qv);
+                    b = _mm256_blend_epi32(even, odd, 0xaa);
+                }
+
+                const __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_add_epi32(_mm256_mullo_epi32(field, qv), a), qv), b);
+                const __m256i thr = _mm256_i32gather_epi32(table.data(), index, 4);
+                const __m256i rv = _mm256_srli_epi32(_mm256_loadu_si256((const __m256i *)(r + nhalf + j)), 1);
+                a = _mm256_blendv_epi8(b, a, _mm256_cmpgt_epi32(rv, thr));
+                // back into the colour-c cells only
+                store_even(s + iy, a);
+            }
+#endif
+            for (; j < jend; j++)
+            {
+                update_site(s, up, down, offset, j, r);
+            }
+        }
+
+    private:
+        static constexpr bool flip = std::is_same<Model, Ising>::value;
+
+        void update_site(value_type *s, const value_type *up, const value_type *down, const int offset, const int j, const std::uint32_t *r) const
+        {
+            const int iy = 2 * j + offset;
+            const int n[4] = {up[iy], s[(iy + 1) % L], down[iy], s[(iy - 1 + L) % L]};
+            const int a = s[iy];
+            const int b = flip ? a ^ 1 : (int)(((std::uint64_t)r[j] * Q) >> 32);
+            if ((std::int32_t)(r[nhalf + j] >> 1) <= table(Field::index(n), a, b))
+            {
+                s[iy] = (value_type)b;
+            }
+        }
+
+#if defined(__AVX2__)
+        // even and odd lanes of the sixteen values lo:hi
+        static void split(const __m256i lo, const __m256i hi, __m256i &even, __m256i &odd)
+        {
+            const __m256i order = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+            const __m256i lo_split = _mm256_permutevar8x32_epi32(lo, order);
+            const __m256i hi_split = _mm256_permutevar8x32_epi32(hi, order);
+            even = _mm256_permute2x128_si256(lo_split, hi_split, 0x20);
+            odd = _mm256_permute2x128_si256(lo_split, hi_split, 0x31);
+        }
+
+        // sixteen consecutive states widened to int32: p[0..7] -> lo, p[8..15] -> hi
+        static void load16(const int *p, __m256i &lo, __m256i &hi)
+        {
+            lo = _mm256_loadu_si256((const __m256i *)p);
+            hi = _mm256_loadu_si256((const __m256i *)(p + 8));
+        }
+        static void load16(const std::uint8_t *p, __m256i &lo, __m256i &hi)
+        {
+            const __m128i bytes = _mm_loadu_si128((const __m128i *)p);
+            lo = _mm256_cvtepu8_epi32(bytes);
+            hi = _mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8));
+        }
+
+        // the eight lanes of a into p[0], p[2], ..., p[14]. The odd cells hold the other colour, which
+        // the neighbouring strips of ParallelCheckerboard read during this half-sweep: never written.
+        static void store_even(int *p, const __m256i a)
+        {
+            const __m256i even = _mm256_setr_epi32(-1, 0, -1, 0, -1, 0, -1, 0);
+            _mm256_maskstore_epi32(p, even, _mm256_permutevar8x32_epi32(a, _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3)));
+            _mm256_maskstore_epi32(p + 8, even, _mm256_permutevar8x32_epi32(a, _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7)));
+        }
+        // AVX2 has no byte-masked store: narrow a to eight bytes and write them one by one
+        static void store_even(std::uint8_t *p, const __m256i a)
+        {
+            const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1));
+            const std::uint64_t bytes = (std::uint64_t)_mm_cvtsi128_si64(_mm_packus_epi16(words, words));
+            for (int k = 0; k != 8; k++)
+            {
+                p[2 * k] = (std::uint8_t)(bytes >> (8 * k));
+            }
+        }
+
+        static __m256i even_lanes(const value_type *p)
+        {
+            __m256i lo, hi, even, odd;
+            load16(p, lo, hi);
+            split(lo, hi, even, odd);
+            return even;
+        }
+
+        static void sort2(__m256i &x, __m256i &y)
+        {
+            const __m256i lo = _mm256_min_epi32(x, y);
+            y = _mm256_max_epi32(x, y);
+            x = lo;
+        }
+#endif
+
+        double coupling_J;
+        double coupling_h;
+        double temperature = 1e0;
+        MetropolisTable<Model> table;
+        std::vector<std::uint32_t> random;
+    };
+}
+
+#endif
@@ -0,0 +1,398 @@
+#ifndef MCMC_CHECKPOINT_HPP
+#define MCMC_CHECKPOINT_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace mcmc
+{
+    class CheckpointWriter;
+
+    /*** true for classes with a template <class Archive> void checkpoint(Archive &) member ***/
+    template <class T, class = void>
+    struct has_checkpoint : std::false_type
+    {
+    };
+    template <class T>
+    struct has_checkpoint<T, std::void_t<decltype(std::declval<T &>().checkpoint(std::declval<CheckpointWriter &>()))>> : std::true_type
+    {
+    };
+
+    /*******************************************************************/
+    /*** Binary archives of a checkpoint; archive(x) writes or       ***/
+    /*** reads x. A class with a checkpoint(Archive &) member        ***/
+    /*** lists its fields there (Archive::loading tells the two      ***/
+    /*** apart), vectors go as their length and elements, and        ***/
+    /*** anything else trivially copyable (Xoshiro256ss, Welford)    ***/
+    /*** as its bytes, in the native byte order: a checkpoint is     ***/
+    /*** resumed on the kind of machine that wrote it.               ***/
+    /*******************************************************************/
+    class CheckpointWriter
+    {
+    public:
+        static constexpr bool loading = false;
+
+        template <class T>
+        void operator()(T &x)
+        {
+            if constexpr (has_checkpoint<T>::value)
+            {
+                x.checkpoint(*this);
+            }
+            else
+            {
+                static_assert(std::is_trivially_copyable<T>::value, "add a checkpoint(Archive &) member");
+                const char *p = reinterpret_cast<const char *>(&x);
+                bytes.insert(bytes.end(), p, p + sizeof(T));
+            }
+        }
+
+        template <class T, class Allocator>
+        void operator()(std::vector<T, Allocator> &x)
+        {
+            std::uint64_t n = x.size();
+            (*this)(n);
+            for (T &element : x)
+            {
+                (*this)(element);
+            }
+        }
+
+        void operator()(std::vector<bool> &x)
+        {
+            std::uint64_t n = x.size();
+            (*this)(n);
+            for (bool element : x)
+            {
+                (*this)(element);
+            }
+        }
+
+        std::vector<char> &data() { return bytes; }
+
+    private:
+        std::vector<char> bytes;
+    };
+
+    class CheckpointReader
+    {
+    public:
+        static constexpr bool loading = true;
+
+        CheckpointReader(const char *first, const char *last) : p(first), last(last) {}
+
+        template <class T>
+        void operator()(T &x)
+        {
+            if constexpr (has_checkpoint<T>::value)
+            {
+                x.checkpoint(*this);
+            }
+            else
+            {
+                static_assert(std::is_trivially_copyable<T>::value, "add a checkpoint(Archive &) member");
+                need(sizeof(T));
+                std::memcpy(reinterpret_cast<char *>(&x), p, sizeof(T));
+                p += sizeof(T);
+            }
+        }
+
+        template <class T, class Allocator>
+        void operator()(std::vector<T, Allocator> &x)
+        {
+            x.resize(length());
+            for (T &element : x)
+            {
+                (*this)(element);
+            }
+        }
+
+        void operator()(std::vector<bool> &x)
+        {
+            x.resize(length());
+            for (std::size_t k = 0; k != x.size(); k++)
+            {
+                bool element;
+                (*this)(element);
+                x[k] = element;
+            }
+        }
+
+        // every byte was read
+        bool done() const { return p == last; }
+
+    private:
+        std::uint64_t length()
+        {
+            std::uint64_t n;
+            (*this)(n);
+            if (n > (std::uint64_t)(last - p))
+            {
+                throw std::runtime_error("vector longer than the record");
+            }
+            return n;
+        }
+
+        void need(const std::size_t n) const
+        {
+            if ((std::size_t)(last - p) < n)
+            {
+                throw std::runtime_error("record ends early");
+            }
+        }
+
+        const char *p;
+        const char *last;
+    };
+
+    /*******************************************************************/
+    /*** Periodic checkpoint of a run made of nslot independent      ***/
+    /*** parts (temperatures, replicas). save(k, state) serializes   ***/
+    /*** part k into slot k, a snapshot its worker never touches     ***/
+    /*** again; a background thread writes all slots every           ***/
+    /*** interval seconds to filename.tmp and renames it over        ***/
+    /*** filename, so the file on disk is always a whole             ***/
+    /*** checkpoint. After a restart restore(k, state) reads part    ***/
+    /*** k back; with the seed and every RNG state stored, the run   ***/
+    /*** goes on bit for bit.                                        ***/
+    /*******************************************************************/
+    class Checkpoint
+    {
+    public:
+        // resume -> read filename (if present) and take the seed stored there instead
+        Checkpoint(const std::string &filename, const int nslot, const std::uint64_t seed, const bool resume, const double interval = 600e0)
+            : filename(filename), seed_(seed), slot(nslot), interval(interval)
+        {
+            if (resume)
+            {
+                load();
+            }
+            writer = std::thread([this]
+                                 { run(); });
+        }
+
+        // writes the last snapshots before returning
+        ~Checkpoint()
+        {
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            wake.notify_one();
+            writer.join();
+        }
+
+        Checkpoint(const Checkpoint &) = delete;
+        Checkpoint &operator=(const Checkpoint &) = delete;
+
+        std::uint64_t seed() const { return seed_; }
+
+        template <class State>
+        void save(const int k, State &state)
+        {
+            CheckpointWriter archive;
+            archive(state);
+            const std::lock_guard<std::mutex> lock(mutex);
+            if (!frozen)
+            {
+                slot[k].swap(archive.data());
+                dirty = true;
+            }
+        }
+
+        // false -> part k has no snapshot and starts from scratch;
+        // throws std::runtime_error when the snapshot does not fit the state, and from then on
+        // nothing is written, so the file can still be resumed with the settings that wrote it.
+        // Restore every part before any of them runs, so that a mismatch costs no work.
+        template <class State>
+        bool restore(const int k, State &state)
+        {
+            std::vector<char> bytes;
+            {
+                const std::lock_guard<std::mutex> lock(mutex);
+                bytes = slot[k];
+            }
+            if (bytes.empty())
+            {
+                return false;
+            }
+            try
+            {
+                CheckpointReader archive(bytes.data(), bytes.data() + bytes.size());
+                archive(state);
+                if (!archive.done())
+                {
+                    throw std::runtime_error("record longer than the state");
+                }
+            }
+            catch (const std::runtime_error &error)
+            {
+                {
+                    const std::lock_guard<std::mutex> lock(mutex);
+                    frozen = true;
+                    dirty = false;
+                }
+                throw std::runtime_error(filename + ": slot " + std::to_string(k) + ": " + error.what());
+            }
+            return true;
+        }
+
+    private:
+        static constexpr char magic[8] = {'M', 'C', 'M', 'C', 'C', 'K', 'P', 'T'};
+        static constexpr std::uint32_t version = 1;
+
+        // FNV-1a over the image, so a torn or foreign file is refused
+        static std::uint64_t checksum(const char *p, const std::size_t n)
+        {
+            std::uint64_t hash = 0xcbf29ce484222325ULL;
+            for (std::size_t k = 0; k != n; k++)
+            {
+                hash = (hash ^ (unsigned char)p[k]) * 0x100000001b3ULL;
+            }
+            return hash;
+        }
+
+        // load() only: the writer thread has not started yet, so nothing is cut short
+        [[noreturn]] void fail(const std::string &why) const
+        {
+            std::cout << filename << ": " << why << std::endl;
+            exit(1);
+        }
+
+        // magic, version, nslot, seed, then every slot as its length and bytes, then the checksum
+        std::vector<char> image()
+        {
+            CheckpointWriter archive;
+            char tag[8];
+            std::memcpy(tag, magic, sizeof(tag));
+            std::uint32_t v = version;
+            std::uint32_t n = (std::uint32_t)slot.size();
+            archive(tag);
+            archive(v);
+            archive(n);
+            archive(seed_);
+            archive(slot);
+            std::vector<char> &bytes = archive.data();
+            std::uint64_t sum = checksum(bytes.data(), bytes.size());
+            archive(sum);
+            return std::move(bytes);
+        }
+
+        void load()
+        {
+            std::ifstream input(filename, std::ios::binary);
+            if (!input)
+            {
+                std::cout << filename << " not found; starting from scratch" << std::endl;
+                return;
+            }
+            const std::vector<char> bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+            if (bytes.size() < sizeof(std::uint64_t))
+            {
+                fail("truncated checkpoint");
+            }
+            const std::size_t body = bytes.size() - sizeof(std::uint64_t);
+            std::uint64_t sum;
+            std::memcpy(&sum, bytes.data() + body, sizeof(sum));
+            if (sum != checksum(bytes.data(), body))
+            {
+                fail("checksum mismatch");
+            }
+            try
+            {
+                CheckpointReader archive(bytes.data(), bytes.data() + body);
+                char tag[8];
+                std::uint32_t v, n;
+                archive(tag);
+                archive(v);
+                archive(n);
+                if (std::memcmp(tag, magic, sizeof(tag)) != 0 || v != version)
+                {
+                    fail("not a checkpoint of this version");
+                }
+                if (n != slot.size())
+                {
+                    fail("written for " + std::to_string(n) + " parts, not " + std::to_string(slot.size()));
+                }
+                archive(seed_);
+                archive(slot);
+            }
+            catch (const std::runtime_error &error)
+            {
+                fail(error.what());
+            }
+            std::cout << "resuming from " << filename << ", seed " << seed_ << std::endl;
+        }
+
+        // temporary file, flushed to disk, then renamed over the old checkpoint
+        void write(const std::vector<char> &bytes) const
+        {
+            const std::string temporary = filename + ".tmp";
+            std::FILE *file = std::fopen(temporary.c_str(), "wb");
+            bool written = file != nullptr && std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size() && std::fflush(file) == 0;
+#if defined(__unix__) || defined(__APPLE__)
+            written = written && fsync(fileno(file)) == 0;
+#endif
+            if (file != nullptr)
+            {
+                written = std::fclose(file) == 0 && written;
+            }
+            if (!written || std::rename(temporary.c_str(), filename.c_str()) != 0)
+            {
+                std::cout << "could not write " << filename << std::endl;
+            }
+        }
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true)
+            {
+                wake.wait_for(lock, std::chrono::duration<double>(interval), [this]
+                              { return stop; });
+                if (dirty)
+                {
+                    const std::vector<char> bytes = image();
+                    dirty = false;
+                    lock.unlock();
+                    write(bytes);
+                    lock.lock();
+                }
+                if (stop)
+                {
+                    return;
+                }
+            }
+        }
+
+        std::string filename;
+        std::uint64_t seed_;
+        std::vector<std::vector<char>> slot;
+        double interval;
+        bool dirty = false;
+        bool frozen = false;
+        bool stop = false;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::thread writer;
+    };
+}
+
+#endif
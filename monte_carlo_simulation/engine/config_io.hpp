@@ -0,0 +1,267 @@
+#ifndef MCMC_CONFIG_IO_HPP
+#define MCMC_CONFIG_IO_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "storage.hpp"
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mcmc
+{
+    /*******************************************************************/
+    /*** Binary configuration, version 1, native byte order:         ***/
+    /***   64-byte ConfigHeader (magic "MCMCSPIN", model name, Q,    ***/
+    /***   nx, ny, T, seed, stream, sweep)                           ***/
+    /***   then the states 0..Q-1 of sites i = ix * ny + iy, packed  ***/
+    /***   at nbit = PackedStorage<Q>::nbit bits into uint64 words:  ***/
+    /***   site i at bit (i % (64 / nbit)) * nbit of word            ***/
+    /***   i / (64 / nbit)                                           ***/
+    /*** A 64 x 64 Ising snapshot is 576 bytes instead of ~40 kB of  ***/
+    /*** text, written with a single write.                          ***/
+    /*******************************************************************/
+    struct ConfigHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t nbit;
+        std::uint32_t q;
+        std::uint32_t nx;
+        std::uint32_t ny;
+        std::int32_t stream;
+        char model[8];
+        double temperature;
+        std::uint64_t seed;
+        std::int64_t sweep;
+    };
+    static_assert(sizeof(ConfigHeader) == 64, "ConfigHeader must stay 64 bytes");
+
+    /*** what a binary configuration records besides the spins ***/
+    struct ConfigInfo
+    {
+        double temperature = 0e0;
+        std::uint64_t seed = 0;
+        int stream = 0;
+        long int sweep = 0;
+    };
+
+    constexpr char config_magic[8] = {'M', 'C', 'M', 'C', 'S', 'P', 'I', 'N'};
+    constexpr std::uint32_t config_version = 1;
+
+    /*********************************************************/
+    /*** Read-only view of a binary configuration: mmap on ***/
+    /*** POSIX, one read into memory elsewhere.            ***/
+    /*********************************************************/
+    class MappedConfig
+    {
+    public:
+        explicit MappedConfig(const std::string &filename)
+        {
+#if defined(__unix__) || defined(__APPLE__)
+            const int fd = open(filename.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                return;
+            }
+            struct stat status;
+            if (fstat(fd, &status) == 0 && status.st_size >= (off_t)sizeof(ConfigHeader))
+            {
+                void *p = mmap(nullptr, (std::size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED)
+                {
+                    base = static_cast<const char *>(p);
+                    size = (std::size_t)status.st_size;
+                }
+            }
+            close(fd);
+#else
+            std::ifstream input(filename, std::ios::binary);
+            buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+            base = buffer.data();
+            size = buffer.size();
+#endif
+            if (size >= sizeof(ConfigHeader))
+            {
+                std::memcpy(&header_, base, sizeof(ConfigHeader));
+                valid_ = std::memcmp(header_.magic, config_magic, sizeof(config_magic)) == 0 && header_.version == config_version &&
+                         (header_.nbit == 1 || header_.nbit == 2 || header_.nbit == 4 || header_.nbit == 8);
+                const std::size_t per_word = valid_ ? 64 / header_.nbit : 1;
+                const std::size_t nword = ((std::size_t)header_.nx * header_.ny + per_word - 1) / per_word;
+                valid_ = valid_ && size >= sizeof(ConfigHeader) + nword * sizeof(std::uint64_t);
+            }
+        }
+
+        ~MappedConfig()
+        {
+#if defined(__unix__) || defined(__APPLE__)
+            if (base != nullptr)
+            {
+                munmap(const_cast<char *>(base), size);
+            }
+#endif
+        }
+
+        MappedConfig(const MappedConfig &) = delete;
+        MappedConfig &operator=(const MappedConfig &) = delete;
+
+        // false -> missing, truncated, or not a binary configuration
+        bool valid() const { return valid_; }
+        const ConfigHeader &header() const { return header_; }
+        std::string model() const { return std::string(header_.model, std::find(header_.model, header_.model + sizeof(header_.model), '\0')); }
+
+        // state of site i = ix * ny + iy
+        int state(const int i) const
+        {
+            const int per_word = 64 / header_.nbit;
+            std::uint64_t word;
+            std::memcpy(&word, base + sizeof(ConfigHeader) + (std::size_t)(i / per_word) * sizeof(std::uint64_t), sizeof(word));
+            return (int)((word >> (i % per_word * header_.nbit)) & ((1ULL << header_.nbit) - 1));
+        }
+
+        // false (with a message) when the file holds another model, Q or size
+        template <class Lattice>
+        bool read(Lattice &spin) const
+        {
+            using Model = typename Lattice::Model;
+            if (model() != Model::name || header_.q != (std::uint32_t)Model::Q || header_.nx != (std::uint32_t)Lattice::nx || header_.ny != (std::uint32_t)Lattice::ny)
+            {
+                std::cout << "configuration is " << model() << " q=" << header_.q << " " << header_.nx << "x" << header_.ny << std::endl;
+                return false;
+            }
+            for (int i = 0; i != Lattice::nsite; i++)
+            {
+                spin.set(i, state(i));
+            }
+            return true;
+        }
+
+    private:
+        const char *base = nullptr;
+        std::size_t size = 0;
+#if !(defined(__unix__) || defined(__APPLE__))
+        std::vector<char> buffer;
+#endif
+        ConfigHeader header_{};
+        bool valid_ = false;
+    };
+
+    /*** binary or text configuration, told apart by the magic ***/
+    template <class Lattice>
+    bool read_config(const std::string &filename, Lattice &spin)
+    {
+        using Model = typename Lattice::Model;
+        {
+            const MappedConfig binary(filename);
+            if (binary.valid())
+            {
+                return binary.read(spin);
+            }
+        }
+        std::ifstream inputconfig(filename);
+        if (!inputconfig)
+        {
+            return false;
+        }
+        int ix, iy, value;
+        while (inputconfig >> ix >> iy >> value)
+        {
+            spin.set(Lattice::index(ix, iy), Model::state(value));
+        }
+        return true;
+    }
+
+    /**************************************************/
+    /*** Text configuration: one "ix iy spin " line ***/
+    /*** per site, spin in the model's value units  ***/
+    /**************************************************/
+    template <class Lattice>
+    void write_text_config(const std::string &filename, const Lattice &spin)
+    {
+        using Model = typename Lattice::Model;
+        std::ofstream outputconfig(filename);
+        for (int ix = 0; ix != Lattice::nx; ix++)
+        {
+            for (int iy = 0; iy != Lattice::ny; iy++)
+            {
+                outputconfig << ix << ' ' << iy << ' ' << Model::value(spin(ix, iy)) << ' ' << '\n';
+            }
+        }
+    }
+
+    template <class Lattice>
+    void write_binary_config(const std::string &filename, const Lattice &spin, const ConfigInfo &info = {})
+    {
+        using Model = typename Lattice::Model;
+        using Packed = PackedStorage<Model::Q>;
+        const std::size_t nword = (Lattice::nsite + Packed::per_word - 1) / Packed::per_word;
+        std::vector<std::uint64_t> word(nword, 0);
+        for (int i = 0; i != Lattice::nsite; i++)
+        {
+            word[i / Packed::per_word] |= (std::uint64_t)spin[i] << (i % Packed::per_word * Packed::nbit);
+        }
+        ConfigHeader header{};
+        std::memcpy(header.magic, config_magic, sizeof(config_magic));
+        std::strncpy(header.model, Model::name, sizeof(header.model));
+        header.version = config_version;
+        header.nbit = Packed::nbit;
+        header.q = Model::Q;
+        header.nx = Lattice::nx;
+        header.ny = Lattice::ny;
+        header.stream = info.stream;
+        header.temperature = info.temperature;
+        header.seed = info.seed;
+        header.sweep = info.sweep;
+        std::vector<char> bytes(sizeof(ConfigHeader) + nword * sizeof(std::uint64_t));
+        std::memcpy(bytes.data(), &header, sizeof(ConfigHeader));
+        std::memcpy(bytes.data() + sizeof(ConfigHeader), word.data(), nword * sizeof(std::uint64_t));
+        std::ofstream outputconfig(filename, std::ios::binary);
+        outputconfig.write(bytes.data(), (std::streamsize)bytes.size());
+    }
+
+    /*** filename ending in .txt -> text export; otherwise the binary format ***/
+    template <class Lattice>
+    void write_config(const std::string &filename, const Lattice &spin, const ConfigInfo &info = {})
+    {
+        const std::string text = ".txt";
+        if (filename.size() >= text.size() && filename.compare(filename.size() - text.size(), text.size(), text) == 0)
+        {
+            write_text_config(filename, spin);
+        }
+        else
+        {
+            write_binary_config(filename, spin, info);
+        }
+    }
+
+    /*** nconfig: 0 -> read filename (binary or text); otherwise every spin = nconfig ***/
+    template <class Lattice>
+    void init_config(Lattice &spin, const int nconfig, const std::string &filename)
+    {
+        using Model = typename Lattice::Model;
+        if (nconfig == 0)
+        {
+            if (!read_config(filename, spin))
+            {
+                std::cout << "inputfile not found" << std::endl;
+                exit(1);
+            }
+        }
+        else
+        {
+            spin.fill(Model::state(nconfig));
+        }
+    }
+}
+
+#endif
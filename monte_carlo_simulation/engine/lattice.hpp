@@ -0,0 +1,293 @@
+#ifndef MCMC_LATTICE_HPP
+#define MCMC_LATTICE_HPP
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "storage.hpp"
+
+namespace mcmc
+{
+    /*****************************************************************/
+    /*** Storage layouts of the L x L square lattice.               ***/
+    /*** Sites keep the index i = ix * ny + iy everywhere; a layout ***/
+    /*** decides which storage cell holds site i and how the       ***/
+    /*** update kernels find the four neighbour cells of a cell.   ***/
+    /*****************************************************************/
+
+    /*** cell = site; neighbours by periodic index arithmetic ***/
+    template <int L>
+    class ModuloLayout
+    {
+    public:
+        static constexpr int ncell = L * L;
+        static constexpr int row_stride = L;
+
+        static constexpr int cell(const int i) { return i; }
+        static constexpr int row(const int ix) { return ix * L; }
+
+        // cells of the four neighbours: +x, +y, -x, -y
+        void neighbours(const int c, int (&n)[4]) const
+        {
+            const int ix = c / L;
+            const int iy = c % L;
+            const int ixp1 = (ix + 1) % L;     // ixp1=ix+1; be careful about the boundary condition.
+            const int iyp1 = (iy + 1) % L;     // iyp1=iy+1; be careful about the boundary condition.
+            const int ixm1 = (ix - 1 + L) % L; // ixm1=ix-1; be careful about the boundary condition.
+            const int iym1 = (iy - 1 + L) % L; // iym1=iy-1; be careful about the boundary condition.
+            n[0] = ixp1 * L + iy;
+            n[1] = ix * L + iyp1;
+            n[2] = ixm1 * L + iy;
+            n[3] = ix * L + iym1;
+        }
+
+        template <class Storage>
+        void neighbour_states(const Storage &spin, const int c, int (&n)[4]) const
+        {
+            int j[4];
+            neighbours(c, j);
+            n[0] = spin.get(j[0]);
+            n[1] = spin.get(j[1]);
+            n[2] = spin.get(j[2]);
+            n[3] = spin.get(j[3]);
+        }
+
+        // nothing is duplicated, so writes need no bookkeeping
+        template <class Storage>
+        static void write_through(Storage &, const int, const int) {}
+        template <class Storage>
+        static void refresh(Storage &) {}
+    };
+
+    /*** cell = site; neighbours from a flat table built once per lattice ***/
+    template <int L>
+    class TableLayout
+    {
+    public:
+        static constexpr int ncell = L * L;
+        static constexpr int row_stride = L;
+
+        TableLayout() : table(4 * ncell)
+        {
+            const ModuloLayout<L> modulo;
+            for (int c = 0; c != ncell; c++)
+            {
+                int n[4];
+                modulo.neighbours(c, n);
+                for (int k = 0; k != 4; k++)
+                {
+                    table[4 * c + k] = n[k];
+                }
+            }
+        }
+
+        static constexpr int cell(const int i) { return i; }
+        static constexpr int row(const int ix) { return ix * L; }
+
+        void neighbours(const int c, int (&n)[4]) const
+        {
+            const int *t = table.data() + 4 * c;
+            n[0] = t[0];
+            n[1] = t[1];
+            n[2] = t[2];
+            n[3] = t[3];
+        }
+
+        template <class Storage>
+        void neighbour_states(const Storage &spin, const int c, int (&n)[4]) const
+        {
+            int j[4];
+            neighbours(c, j);
+            n[0] = spin.get(j[0]);
+            n[1] = spin.get(j[1]);
+            n[2] = spin.get(j[2]);
+            n[3] = spin.get(j[3]);
+        }
+
+        template <class Storage>
+        static void write_through(Storage &, const int, const int) {}
+        template <class Storage>
+        static void refresh(Storage &) {}
+
+    private:
+        std::vector<int> table;
+    };
+
+    /*****************************************************************/
+    /*** (L + 2) x (L + 2) storage with ghost rows and columns that ***/
+    /*** copy the opposite edge, so the neighbour states of a cell  ***/
+    /*** are at c +- 1 and c +- (L + 2). Cluster kernels need the   ***/
+    /*** real cells behind the ghosts, which come from a table.     ***/
+    /*** Single-site writes refresh the ghost copies at once; row   ***/
+    /*** kernels call refresh() after a half sweep.                 ***/
+    /*****************************************************************/
+    template <int L>
+    class HaloLayout
+    {
+    public:
+        static constexpr int row_stride = L + 2;
+        static constexpr int ncell = row_stride * row_stride;
+
+        HaloLayout() : home(ncell, 0)
+        {
+            for (int ix = 0; ix != row_stride; ix++)
+            {
+                for (int iy = 0; iy != row_stride; iy++)
+                {
+                    home[ix * row_stride + iy] = row((ix - 1 + L) % L) + (iy - 1 + L) % L;
+                }
+            }
+        }
+
+        static constexpr int cell(const int i) { return row(i / L) + i % L; }
+        static constexpr int row(const int ix) { return (ix + 1) * row_stride + 1; }
+
+        void neighbours(const int c, int (&n)[4]) const
+        {
+            n[0] = home[c + row_stride];
+            n[1] = home[c + 1];
+            n[2] = home[c - row_stride];
+            n[3] = home[c - 1];
+        }
+
+        template <class Storage>
+        static void neighbour_states(const Storage &spin, const int c, int (&n)[4])
+        {
+            n[0] = spin.get(c + row_stride);
+            n[1] = spin.get(c + 1);
+            n[2] = spin.get(c - row_stride);
+            n[3] = spin.get(c - 1);
+        }
+
+        template <class Storage>
+        static void write_through(Storage &spin, const int c, const int state)
+        {
+            const int ix = c / row_stride;
+            const int iy = c % row_stride;
+            if (ix == 1)
+            {
+                spin.set(c + L * row_stride, state);
+            }
+            else if (ix == L)
+            {
+                spin.set(c - L * row_stride, state);
+            }
+            if (iy == 1)
+            {
+                spin.set(c + L, state);
+            }
+            else if (iy == L)
+            {
+                spin.set(c - L, state);
+            }
+        }
+
+        // copies every edge into its ghost row or column
+        template <class Storage>
+        static void refresh(Storage &spin)
+        {
+            for (int ix = 1; ix <= L; ix++)
+            {
+                spin.set(ix * row_stride, spin.get(ix * row_stride + L));
+                spin.set(ix * row_stride + L + 1, spin.get(ix * row_stride + 1));
+            }
+            for (int iy = 1; iy <= L; iy++)
+            {
+                spin.set(iy, spin.get(L * row_stride + iy));
+                spin.set((L + 1) * row_stride + iy, spin.get(row_stride + iy));
+            }
+        }
+
+    private:
+        std::vector<int> home;
+    };
+
+    /********************************************************/
+    /*** L x L square lattice, periodic boundaries        ***/
+    /*** site index i = ix * ny + iy                      ***/
+    /*** Storage_: IntStorage, ByteStorage, PackedStorage ***/
+    /********************************************************/
+    template <class Model_, int L_, template <int> class Layout_ = ModuloLayout, template <int> class Storage_ = IntStorage>
+    class SquareLattice
+    {
+    public:
+        using Model = Model_;
+        using Layout = Layout_<L_>;
+        using Storage = Storage_<Model_::Q>;
+        static constexpr int L = L_;
+        static constexpr int nx = L; // number of sites along x-direction
+        static constexpr int ny = L; // number of sites along y-direction
+        static constexpr int nsite = nx * ny;
+        static constexpr int ncell = Layout::ncell;
+
+        SquareLattice() : spin(ncell) {}
+
+        static constexpr int index(const int ix, const int iy) { return ix * ny + iy; }
+
+        // neighbours of site i; be careful about the boundary condition.
+        static constexpr int xp(const int i) { return index((i / ny + 1) % nx, i % ny); }
+        static constexpr int xm(const int i) { return index((i / ny - 1 + nx) % nx, i % ny); }
+        static constexpr int yp(const int i) { return index(i / ny, (i % ny + 1) % ny); }
+        static constexpr int ym(const int i) { return index(i / ny, (i % ny - 1 + ny) % ny); }
+
+        int operator[](const int i) const { return spin.get(Layout::cell(i)); }
+        int operator()(const int ix, const int iy) const { return spin.get(Layout::cell(index(ix, iy))); }
+        void set(const int i, const int state) { set_cell(Layout::cell(i), state); }
+
+        // states of the four neighbours of site i: +x, +y, -x, -y
+        void neighbour_states(const int i, int (&n)[4]) const { cell_neighbour_states(Layout::cell(i), n); }
+
+        void fill(const int state) { spin.fill(state); }
+
+        /*** storage cells, for the update kernels; neighbour_cells never returns a ghost ***/
+        static constexpr int cell(const int i) { return Layout::cell(i); }
+        int cell_state(const int c) const { return spin.get(c); }
+        void set_cell(const int c, const int state)
+        {
+            spin.set(c, state);
+            Layout::write_through(spin, c, state);
+        }
+        void neighbour_cells(const int c, int (&n)[4]) const { layout.neighbours(c, n); }
+        void cell_neighbour_states(const int c, int (&n)[4]) const { layout.neighbour_states(spin, c, n); }
+
+        // row ix: the states of sites iy = 0..ny-1 (IntStorage / ByteStorage only);
+        // call refresh() after writing through it
+        auto *row(const int ix) { return spin.data() + Layout::row(ix); }
+        const auto *row(const int ix) const { return spin.data() + Layout::row(ix); }
+        void refresh() { Layout::refresh(spin); }
+
+        // states packed at PackedStorage<Q>::nbit bits per site, for mcmc::CheckpointWriter / CheckpointReader
+        template <class Archive>
+        void checkpoint(Archive &archive)
+        {
+            using Packed = PackedStorage<Model::Q>;
+            std::vector<std::uint64_t> word((nsite + Packed::per_word - 1) / Packed::per_word, 0);
+            if constexpr (!Archive::loading)
+            {
+                for (int i = 0; i != nsite; i++)
+                {
+                    word[i / Packed::per_word] |= (std::uint64_t)(*this)[i] << (i % Packed::per_word * Packed::nbit);
+                }
+            }
+            const std::size_t nword = word.size();
+            archive(word);
+            if constexpr (Archive::loading)
+            {
+                if (word.size() != nword)
+                {
+                    throw std::runtime_error("lattice size differs");
+                }
+                for (int i = 0; i != nsite; i++)
+                {
+                    set(i, (int)((word[i / Packed::per_word] >> (i % Packed::per_word * Packed::nbit)) & Packed::mask));
+                }
+            }
+        }
+
+    private:
+        Layout layout;
+        Storage spin;
+    };
+}
+
+#endif
@@ -0,0 +1,459 @@
+#ifndef MCMC_MULTICANONICAL_HPP
+#define MCMC_MULTICANONICAL_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "random.hpp"
+#include "observables.hpp"
+
+namespace mcmc
+{
+    /*******************************************************************/
+    /*** Wang-Landau walk in the bond sum                            ***/
+    /***   B = sum_<ij> bond(s_i, s_j),  E = -J B                    ***/
+    /*** restricted to the window [lower, upper].                    ***/
+    /*** A single-site move from B to B' is accepted with            ***/
+    /***   min(1, g(B) / g(B'))                                      ***/
+    /*** and ln g(B) of the bin the walker ends in grows by ln f. B  ***/
+    /*** follows the move through RunningTotals, so a step is O(1).  ***/
+    /*** With ln f = 0 and a fixed ln g the same kernel is a         ***/
+    /*** multicanonical walk. Needs an integer bond (Ising, Potts).  ***/
+    /*******************************************************************/
+    template <class Lattice>
+    class WangLandau
+    {
+    public:
+        using Model = typename Lattice::Model;
+        static_assert(std::is_integral<decltype(Model::bond_change(0, 0, std::declval<const int (&)[4]>()))>::value,
+                      "WangLandau bins the bond sum, which must be an integer");
+        static constexpr int nbin = 4 * Lattice::nsite + 1; // B = -2N .. 2N
+
+        static int bin(const RunningTotals<Model> &totals) { return (int)std::lround(totals.bond()) + 2 * Lattice::nsite; }
+        static double bond(const int b) { return b - 2 * Lattice::nsite; }
+
+        explicit WangLandau(const int lower = 0, const int upper = nbin - 1)
+            : lower(lower), upper(upper), ln_g(nbin, 0e0), histogram(nbin, 0)
+        {
+        }
+
+        template <class Rng>
+        bool step(Lattice &spin, Rng &rng, RunningTotals<Model> &totals)
+        {
+            const int c = spin.cell(rng.below(Lattice::nsite));
+            const int s = spin.cell_state(c);
+            const int next_spin = Model::propose(s, rng);
+            int n[4];
+            spin.cell_neighbour_states(c, n);
+            const int bond_change = -Model::bond_change(s, next_spin, n);
+            int now = bin(totals);
+            const int after = now + bond_change;
+            bool accepted = false;
+            if (after >= lower && after <= upper && (ln_g[after] <= ln_g[now] || rng.uniform() < std::exp(ln_g[now] - ln_g[after])))
+            {
+                // accept
+                spin.set_cell(c, next_spin);
+                totals.change(s, next_spin, bond_change);
+                now = after;
+                accepted = true;
+            }
+            ln_g[now] += ln_f;
+            histogram[now]++;
+            return accepted;
+        }
+
+        template <class Rng>
+        long int sweep(Lattice &spin, Rng &rng, RunningTotals<Model> &totals)
+        {
+            long int naccept = 0;
+            for (int k = 0; k != Lattice::nsite; k++)
+            {
+                naccept += step(spin, rng, totals);
+            }
+            return naccept;
+        }
+
+        // single-site moves that never take B further from the window, until it is inside
+        template <class Rng>
+        void enter(Lattice &spin, Rng &rng, RunningTotals<Model> &totals) const
+        {
+            while (!inside(totals))
+            {
+                const int c = spin.cell(rng.below(Lattice::nsite));
+                const int s = spin.cell_state(c);
+                const int next_spin = Model::propose(s, rng);
+                int n[4];
+                spin.cell_neighbour_states(c, n);
+                const int bond_change = -Model::bond_change(s, next_spin, n);
+                const int now = bin(totals);
+                if (distance(now + bond_change) <= distance(now))
+                {
+                    spin.set_cell(c, next_spin);
+                    totals.change(s, next_spin, bond_change);
+                }
+            }
+        }
+
+        bool inside(const RunningTotals<Model> &totals) const { return distance(bin(totals)) == 0; }
+
+        // min H >= flatness * mean H over the bins of the window that have been reached
+        bool flat(const double flatness) const
+        {
+            long int smallest = std::numeric_limits<long int>::max();
+            double sum = 0e0;
+            int nvisited = 0;
+            for (int b = lower; b <= upper; b++)
+            {
+                if (ln_g[b] > 0e0)
+                {
+                    smallest = histogram[b] < smallest ? histogram[b] : smallest;
+                    sum += histogram[b];
+                    nvisited++;
+                }
+            }
+            return nvisited > 1 && smallest >= flatness * sum / nvisited;
+        }
+
+        // ln f -> ln f / 2 and a fresh histogram
+        void next_stage()
+        {
+            ln_f *= 0.5;
+            std::fill(histogram.begin(), histogram.end(), 0);
+        }
+
+        // fixed weights: ln g stays as given (multicanonical walk)
+        void set_log_density(const std::vector<double> &log_density)
+        {
+            ln_g = log_density;
+            ln_f = 0e0;
+            std::fill(histogram.begin(), histogram.end(), 0);
+        }
+
+        double get_ln_f() const { return ln_f; }
+        int get_lower() const { return lower; }
+        int get_upper() const { return upper; }
+        double log_density(const int b) const { return ln_g[b]; }
+        long int visits(const int b) const { return histogram[b]; }
+
+    private:
+        int distance(const int b) const { return b < lower ? lower - b : (b > upper ? b - upper : 0); }
+
+        int lower;
+        int upper;
+        double ln_f = 1e0;
+        std::vector<double> ln_g;
+        std::vector<long int> histogram;
+    };
+
+    /*******************************************************************/
+    /*** Replica-exchange Wang-Landau (Vogel et al.): the B range is ***/
+    /*** split into overlapping windows, one walker per window and   ***/
+    /*** per OpenMP thread. Between rounds of sweeps, walkers of     ***/
+    /*** neighbouring windows swap configurations with probability   ***/
+    /***   min(1, g_w(B_a) g_w+1(B_b) / (g_w(B_b) g_w+1(B_a)))       ***/
+    /*** when both B lie in the overlap. Each window halves its ln f ***/
+    /*** whenever its histogram is flat; run() stops once every      ***/
+    /*** window is below ln_f_final. log_density() joins the windows ***/
+    /*** by matching ln g on their overlaps.                         ***/
+    /*******************************************************************/
+    template <class Lattice, class Rng = Xoshiro256ss>
+    class ParallelWangLandau
+    {
+    public:
+        using Model = typename Lattice::Model;
+        using Walk = WangLandau<Lattice>;
+        static constexpr int nbin = Walk::nbin;
+
+        // windows cover bond sums lower..upper; overlap is the fraction a window shares with the next
+        ParallelWangLandau(const int bond_lower, const int bond_upper, const int nwindow, const double overlap, const std::uint64_t seed)
+            : nwindow(nwindow), swap_rng(seed, nwindow), ntry(nwindow, 0), naccept(nwindow, 0)
+        {
+            const int lower = bond_lower + 2 * Lattice::nsite;
+            const int upper = bond_upper + 2 * Lattice::nsite;
+            const double width = (upper - lower) / (nwindow - (nwindow - 1) * overlap);
+            for (int w = 0; w != nwindow; w++)
+            {
+                const int first = lower + (int)std::lround(w * (1e0 - overlap) * width);
+                const int last = w == nwindow - 1 ? upper : (int)std::lround(first + width);
+                walk.emplace_back(first, last);
+                rng.emplace_back(seed, w);
+                config.push_back(w);
+            }
+            spin.resize(nwindow);
+            for (int w = 0; w != nwindow; w++)
+            {
+                spin[w].fill(0);
+                totals.emplace_back(spin[w]);
+            }
+#ifdef _OPENMP
+            nthread = omp_get_max_threads();
+#endif
+            nthread = nthread < nwindow ? nthread : nwindow;
+        }
+
+        // returns the number of exchange rounds
+        long int run(const double ln_f_final, const double flatness = 0.8, const int nsweep = 100)
+        {
+#pragma omp parallel for schedule(static, 1) num_threads(nthread)
+            for (int w = 0; w < nwindow; w++)
+            {
+                walk[w].enter(spin[w], rng[w], totals[w]);
+            }
+            long int round = 0;
+            while (!done(ln_f_final))
+            {
+#pragma omp parallel for schedule(static, 1) num_threads(nthread)
+                for (int w = 0; w < nwindow; w++)
+                {
+                    const int c = config[w];
+                    for (int k = 0; k != nsweep; k++)
+                    {
+                        walk[w].sweep(spin[c], rng[w], totals[c]);
+                    }
+                    if (walk[w].get_ln_f() >= ln_f_final && walk[w].flat(flatness))
+                    {
+                        walk[w].next_stage();
+                    }
+                }
+                exchange(round & 1);
+                round++;
+            }
+            return round;
+        }
+
+        // ln g(B) over all bins, normalised to ln g = ln Q at the ground state; -inf where never reached
+        std::vector<double> log_density() const
+        {
+            std::vector<double> ln_g(nbin, -std::numeric_limits<double>::infinity());
+            for (int w = 0; w != nwindow; w++)
+            {
+                // shift window w onto the part already joined, by the mean difference on the overlap
+                double shift = 0e0;
+                int noverlap = 0;
+                for (int b = walk[w].get_lower(); w != 0 && b <= walk[w - 1].get_upper(); b++)
+                {
+                    if (walk[w].log_density(b) > 0e0 && std::isfinite(ln_g[b]))
+                    {
+                        shift += ln_g[b] - walk[w].log_density(b);
+                        noverlap++;
+                    }
+                }
+                shift = noverlap ? shift / noverlap : 0e0;
+                // and take over from the middle of the overlap
+                const int join = w == 0 ? walk[0].get_lower() : (walk[w].get_lower() + walk[w - 1].get_upper()) / 2;
+                for (int b = join; b <= walk[w].get_upper(); b++)
+                {
+                    ln_g[b] = walk[w].log_density(b) > 0e0 ? walk[w].log_density(b) + shift : -std::numeric_limits<double>::infinity();
+                }
+            }
+            int top = nbin - 1;
+            while (top > 0 && !std::isfinite(ln_g[top]))
+            {
+                top--;
+            }
+            const double offset = std::log((double)Model::Q) - ln_g[top];
+            for (double &value : ln_g)
+            {
+                value += offset;
+            }
+            return ln_g;
+        }
+
+        int size() const { return nwindow; }
+        int get_num_threads() const { return nthread; }
+        const Walk &window(const int w) const { return walk[w]; }
+        const Rng &generator(const int w) const { return rng[w]; }
+        // fraction of accepted configuration swaps between windows w and w + 1
+        double acceptance(const int w) const { return ntry[w] ? naccept[w] / (double)ntry[w] : 0e0; }
+
+    private:
+        bool done(const double ln_f_final) const
+        {
+            for (const Walk &w : walk)
+            {
+                if (w.get_ln_f() >= ln_f_final)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void exchange(const int parity)
+        {
+            for (int w = parity; w + 1 < nwindow; w += 2)
+            {
+                const int a = config[w];
+                const int b = config[w + 1];
+                const int ba = Walk::bin(totals[a]);
+                const int bb = Walk::bin(totals[b]);
+                if (ba < walk[w + 1].get_lower() || bb > walk[w].get_upper())
+                {
+                    continue; // not both in the overlap
+                }
+                const double delta = walk[w].log_density(ba) - walk[w].log_density(bb) + walk[w + 1].log_density(bb) - walk[w + 1].log_density(ba);
+                ntry[w]++;
+                if (delta >= 0e0 || swap_rng.uniform() < std::exp(delta))
+                {
+                    naccept[w]++;
+                    config[w] = b;
+                    config[w + 1] = a;
+                }
+            }
+        }
+
+        int nwindow;
+        int nthread = 1;
+        std::vector<Walk> walk; // walk[w] owns window w
+        std::vector<Rng> rng;   // rng[w] belongs to window w
+        Rng swap_rng;
+        std::vector<Lattice> spin;
+        std::vector<RunningTotals<Model>> totals;
+        std::vector<int> config; // configuration currently in window w
+        std::vector<long int> ntry;
+        std::vector<long int> naccept;
+    };
+
+    /*** canonical averages from a multicanonical run (per site, like the calc_parameter drivers) ***/
+    struct MulticanonicalEstimate
+    {
+        double temperature;
+        double energy;          // <E> / N
+        double specific_heat;   // (<E^2> - <E>^2) / (T^2 N)
+        double order_parameter; // <(Q max_a N_a / N - 1) / (Q - 1)>
+        double binder_ratio;    // <m^4> / <m^2>^2
+    };
+
+    /*******************************************************************/
+    /*** Multicanonical production run: a WangLandau walk with ln g  ***/
+    /*** frozen, which samples P(B) ~ g(B) / g_est(B), roughly flat  ***/
+    /*** across the transition. measure() adds the observables of    ***/
+    /*** the current configuration to per-bin sums S_O(B) and counts ***/
+    /*** H(B), merge() adds another walker's sums, and at(T)         ***/
+    /*** reweights to the canonical ensemble                         ***/
+    /***   <O>_T = sum_B w(B) S_O(B) / sum_B w(B) H(B)               ***/
+    /***   w(B)  = g_est(B) exp(J B / T)                             ***/
+    /*** so one run gives every temperature inside the B range.      ***/
+    /*******************************************************************/
+    template <class Lattice>
+    class Multicanonical
+    {
+    public:
+        using Model = typename Lattice::Model;
+        using Walk = WangLandau<Lattice>;
+        static constexpr int nbin = Walk::nbin;
+
+        Multicanonical(const std::vector<double> &log_density, const double coupling_J)
+            : coupling_J(coupling_J), count(nbin, 0), order_sum(nbin, 0e0), m2_sum(nbin, 0e0), m4_sum(nbin, 0e0)
+        {
+            int lower = 0;
+            while (lower < nbin - 1 && !std::isfinite(log_density[lower]))
+            {
+                lower++;
+            }
+            int upper = nbin - 1;
+            while (upper > lower && !std::isfinite(log_density[upper]))
+            {
+                upper--;
+            }
+            // bins inside the range that were never reached are never entered
+            std::vector<double> weight = log_density;
+            for (int b = lower; b <= upper; b++)
+            {
+                weight[b] = std::isfinite(weight[b]) ? weight[b] : std::numeric_limits<double>::infinity();
+            }
+            walk = Walk(lower, upper);
+            walk.set_log_density(weight);
+        }
+
+        template <class Rng>
+        void enter(Lattice &spin, Rng &rng, RunningTotals<Model> &totals) const { walk.enter(spin, rng, totals); }
+
+        template <class Rng>
+        long int sweep(Lattice &spin, Rng &rng, RunningTotals<Model> &totals) { return walk.sweep(spin, rng, totals); }
+
+        void measure(const RunningTotals<Model> &totals)
+        {
+            const int b = Walk::bin(totals);
+            const double m2 = totals.squared_magnetization();
+            count[b]++;
+            order_sum[b] += calc_order_parameter(totals);
+            m2_sum[b] += m2;
+            m4_sum[b] += m2 * m2;
+        }
+
+        // add the sums of a walker that used the same ln g
+        void merge(const Multicanonical &other)
+        {
+            for (int b = 0; b != nbin; b++)
+            {
+                count[b] += other.count[b];
+                order_sum[b] += other.order_sum[b];
+                m2_sum[b] += other.m2_sum[b];
+                m4_sum[b] += other.m4_sum[b];
+            }
+        }
+
+        MulticanonicalEstimate at(const double temperature) const
+        {
+            // ln of g_est(B) e^{JB/T}, shifted by its largest value over the sampled bins
+            double shift = -std::numeric_limits<double>::infinity();
+            for (int b = 0; b != nbin; b++)
+            {
+                if (count[b] > 0)
+                {
+                    shift = std::fmax(shift, walk.log_density(b) + coupling_J * Walk::bond(b) / temperature);
+                }
+            }
+            double w0 = 0e0, e1 = 0e0, e2 = 0e0, order = 0e0, m2 = 0e0, m4 = 0e0;
+            for (int b = 0; b != nbin; b++)
+            {
+                if (count[b] == 0)
+                {
+                    continue;
+                }
+                const double w = std::exp(walk.log_density(b) + coupling_J * Walk::bond(b) / temperature - shift);
+                const double E = -coupling_J * Walk::bond(b);
+                w0 += w * count[b];
+                e1 += w * count[b] * E;
+                e2 += w * count[b] * E * E;
+                order += w * order_sum[b];
+                m2 += w * m2_sum[b];
+                m4 += w * m4_sum[b];
+            }
+            e1 /= w0;
+            e2 /= w0;
+            order /= w0;
+            m2 /= w0;
+            m4 /= w0;
+            MulticanonicalEstimate estimate;
+            estimate.temperature = temperature;
+            estimate.energy = e1 / Lattice::nsite;
+            estimate.specific_heat = (e2 - e1 * e1) / (temperature * temperature * Lattice::nsite);
+            estimate.order_parameter = order;
+            estimate.binder_ratio = m4 / (m2 * m2);
+            return estimate;
+        }
+
+        // ln g(B) refined by the production histogram: ln g_est(B) + ln H(B)
+        double log_density(const int b) const { return count[b] ? walk.log_density(b) + std::log((double)count[b]) : -std::numeric_limits<double>::infinity(); }
+        long int samples(const int b) const { return count[b]; }
+
+    private:
+        double coupling_J;
+        Walk walk;
+        std::vector<long int> count;
+        std::vector<double> order_sum;
+        std::vector<double> m2_sum;
+        std::vector<double> m4_sum;
+    };
+}
+
+#endif
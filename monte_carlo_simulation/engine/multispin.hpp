@@ -0,0 +1,217 @@
+#ifndef MCMC_MULTISPIN_HPP
+#define MCMC_MULTISPIN_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "spin_models.hpp"
+
+namespace mcmc
+{
+    /******************************************************************/
+    /*** Multi-spin coded Ising lattice: 64 independent replicas     ***/
+    /*** bit r of word[i] is the state (0 -> +1, 1 -> -1) of site i  ***/
+    /*** in replica r; site index i = ix * ny + iy                   ***/
+    /******************************************************************/
+    template <int L_>
+    class MultiSpinIsing
+    {
+    public:
+        static_assert(L_ % 2 == 0, "multi-spin checkerboard needs an even L");
+        using Model = Ising;
+        static constexpr int L = L_;
+        static constexpr int nx = L; // number of sites along x-direction
+        static constexpr int ny = L; // number of sites along y-direction
+        static constexpr int nsite = nx * ny;
+        static constexpr int nreplica = 64;
+
+        MultiSpinIsing() : word(nsite, 0) {}
+
+        static constexpr int index(const int ix, const int iy) { return ix * ny + iy; }
+        static constexpr int xp(const int i) { return index((i / ny + 1) % nx, i % ny); }
+        static constexpr int xm(const int i) { return index((i / ny - 1 + nx) % nx, i % ny); }
+        static constexpr int yp(const int i) { return index(i / ny, (i % ny + 1) % ny); }
+        static constexpr int ym(const int i) { return index(i / ny, (i % ny - 1 + ny) % ny); }
+
+        // writes set the site in every replica (used for the initial configuration)
+        void set(const int i, const int state) { word[i] = state ? ~0ULL : 0ULL; }
+        void fill(const int state)
+        {
+            for (int i = 0; i != nsite; i++)
+            {
+                set(i, state);
+            }
+        }
+
+        int state(const int r, const int i) const { return (int)((word[i] >> r) & 1); }
+        std::uint64_t &operator[](const int i) { return word[i]; }
+        std::uint64_t operator[](const int i) const { return word[i]; }
+
+    private:
+        std::vector<std::uint64_t> word;
+    };
+
+    /*** read-only view of one replica; usable with observables and config_io ***/
+    template <int L_>
+    class MultiSpinReplica
+    {
+    public:
+        using Lattice = MultiSpinIsing<L_>;
+        using Model = Ising;
+        static constexpr int L = L_;
+        static constexpr int nx = L;
+        static constexpr int ny = L;
+        static constexpr int nsite = nx * ny;
+
+        MultiSpinReplica(const Lattice &spin, const int r) : spin(spin), r(r) {}
+
+        static constexpr int index(const int ix, const int iy) { return Lattice::index(ix, iy); }
+        static constexpr int xp(const int i) { return Lattice::xp(i); }
+        static constexpr int xm(const int i) { return Lattice::xm(i); }
+        static constexpr int yp(const int i) { return Lattice::yp(i); }
+        static constexpr int ym(const int i) { return Lattice::ym(i); }
+
+        int operator[](const int i) const { return spin.state(r, i); }
+        int operator()(const int ix, const int iy) const { return spin.state(r, index(ix, iy)); }
+
+    private:
+        const Lattice &spin;
+        const int r;
+    };
+
+    /*** number of replicas held by a lattice type, and access to replica r ***/
+    template <class Lattice>
+    struct replica_count
+    {
+        static constexpr int value = 1;
+    };
+    template <int L>
+    struct replica_count<MultiSpinIsing<L>>
+    {
+        static constexpr int value = MultiSpinIsing<L>::nreplica;
+    };
+
+    template <class Lattice>
+    const Lattice &replica(const Lattice &spin, const int)
+    {
+        return spin;
+    }
+    template <int L>
+    MultiSpinReplica<L> replica(const MultiSpinIsing<L> &spin, const int r)
+    {
+        return MultiSpinReplica<L>(spin, r);
+    }
+
+    /*******************************************************************/
+    /*** Checkerboard Metropolis sweep on all 64 replicas at once      ***/
+    /***   a_k = s ^ n_k marks the anti-parallel neighbours; with k    ***/
+    /***   of them dE = 2J (4 - 2k), so k >= 2 is always accepted,    ***/
+    /***   k = 1 with exp(-4J/T) and k = 0 with exp(-8J/T) = p1 * p1.  ***/
+    /***   The per-bit Bernoulli masks come from comparing 64 bit-    ***/
+    /***   sliced uniforms against the binary expansion of p1.        ***/
+    /*******************************************************************/
+    template <int L>
+    class MultiSpinMetropolis
+    {
+    public:
+        using Lattice = MultiSpinIsing<L>;
+        static constexpr int nprecision = 32; // bits of the acceptance probability
+
+        MultiSpinMetropolis(const double coupling_J, const double coupling_h, const double temperature)
+            : coupling_J(coupling_J)
+        {
+            // the same signature as the other updates, but only h = 0 is implemented
+            if (coupling_h != 0e0)
+            {
+                throw std::invalid_argument("MultiSpinMetropolis: only coupling_h = 0 is implemented");
+            }
+            set_temperature(temperature);
+        }
+
+        void set_temperature(const double T)
+        {
+            temperature = T;
+            const double p1 = std::exp(-4e0 * coupling_J / temperature);
+            probability_bits = (std::uint64_t)std::ldexp(p1 >= 1e0 ? 1e0 : p1, nprecision);
+        }
+        double get_temperature() const { return temperature; }
+
+        template <class Rng>
+        void sweep(Lattice &spin, Rng &rng) const
+        {
+            half_sweep(spin, rng, 0);
+            half_sweep(spin, rng, 1);
+        }
+
+        template <class Rng>
+        void half_sweep(Lattice &spin, Rng &rng, const int c) const
+        {
+            for (int ix = 0; ix != L; ix++)
+            {
+                const int ixp1 = (ix + 1) % L;
+                const int ixm1 = (ix - 1 + L) % L;
+                for (int iy = (ix + c) & 1; iy < L; iy += 2)
+                {
+                    const int iyp1 = (iy + 1) % L;
+                    const int iym1 = (iy - 1 + L) % L;
+                    const std::uint64_t s = spin[Lattice::index(ix, iy)];
+                    const std::uint64_t a0 = s ^ spin[Lattice::index(ixp1, iy)];
+                    const std::uint64_t a1 = s ^ spin[Lattice::index(ix, iyp1)];
+                    const std::uint64_t a2 = s ^ spin[Lattice::index(ixm1, iy)];
+                    const std::uint64_t a3 = s ^ spin[Lattice::index(ix, iym1)];
+                    // bit-sliced count of the anti-parallel neighbours
+                    const std::uint64_t s01 = a0 ^ a1, c01 = a0 & a1;
+                    const std::uint64_t s23 = a2 ^ a3, c23 = a2 & a3;
+                    const std::uint64_t two_or_more = c01 | c23 | (s01 & s23);
+                    const std::uint64_t exactly_one = (s01 ^ s23) & ~two_or_more;
+                    const std::uint64_t none = ~(s01 | s23 | two_or_more);
+                    std::uint64_t accept = two_or_more;
+                    if (exactly_one | none)
+                    {
+                        const std::uint64_t r1 = bernoulli_mask(rng);
+                        accept |= exactly_one & r1;
+                        if (none & r1)
+                        {
+                            accept |= none & r1 & bernoulli_mask(rng);
+                        }
+                    }
+                    spin[Lattice::index(ix, iy)] = s ^ accept;
+                }
+            }
+        }
+
+    private:
+        // every bit is 1 with probability exp(-4J/T): bit-sliced U < p, MSB first
+        template <class Rng>
+        std::uint64_t bernoulli_mask(Rng &rng) const
+        {
+            if (probability_bits >> nprecision)
+            {
+                return ~0ULL; // p = 1
+            }
+            std::uint64_t less = 0;
+            std::uint64_t undecided = ~0ULL;
+            for (int k = nprecision - 1; k >= 0 && undecided; k--)
+            {
+                const std::uint64_t r = rng.next_u64();
+                if ((probability_bits >> k) & 1)
+                {
+                    less |= undecided & ~r;
+                    undecided &= r;
+                }
+                else
+                {
+                    undecided &= ~r;
+                }
+            }
+            return less;
+        }
+
+        double coupling_J;
+        double temperature = 1e0;
+        std::uint64_t probability_bits = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef MCMC_OBSERVABLES_HPP
+#define MCMC_OBSERVABLES_HPP
+
+#include <array>
+
+namespace mcmc
+{
+    /*********************************/
+    /*** Calculation of the energy ***/
+    /*********************************/
+    template <class Lattice>
+    double calc_energy(const Lattice &spin, const double coupling_J, const double coupling_h = 0e0)
+    {
+        using Model = typename Lattice::Model;
+        double sum1 = 0;
+        double sum2 = 0;
+        for (int i = 0; i != Lattice::nsite; i++)
+        {
+            sum1 = sum1 + Model::site(spin[i]);
+            sum2 = sum2 + Model::bond(spin[i], spin[Lattice::xp(i)]) + Model::bond(spin[i], spin[Lattice::yp(i)]);
+        }
+        return -(sum2 * coupling_J + sum1 * coupling_h);
+    }
+
+    /*** action = energy / temperature ***/
+    template <class Lattice>
+    double calc_action(const Lattice &spin, const double coupling_J, const double coupling_h, const double temperature)
+    {
+        return calc_energy(spin, coupling_J, coupling_h) / temperature;
+    }
+
+    /*************************************/
+    /*** Calculation of the total spin ***/
+    /*************************************/
+    template <class Lattice>
+    int calc_total_spin(const Lattice &spin)
+    {
+        using Model = typename Lattice::Model;
+        int total_spin = 0;
+        for (int i = 0; i != Lattice::nsite; i++)
+        {
+            total_spin = total_spin + Model::value(spin[i]);
+        }
+        return total_spin;
+    }
+
+    template <class Lattice>
+    int calc_total_plus_spin(const Lattice &spin)
+    {
+        using Model = typename Lattice::Model;
+        int total_spin = 0;
+        for (int i = 0; i != Lattice::nsite; i++)
+        {
+            if (Model::value(spin[i]) == 1)
+            {
+                total_spin++;
+            }
+        }
+        return total_spin;
+    }
+
+    /*** number of sites in every state ***/
+    template <class Lattice>
+    std::array<int, Lattice::Model::Q> calc_state_histogram(const Lattice &spin)
+    {
+        std::array<int, Lattice::Model::Q> m{};
+        for (int i = 0; i != Lattice::nsite; i++)
+        {
+            m[spin[i]] += 1;
+        }
+        return m;
+    }
+
+    /*** squared Potts order parameter from the number of sites in every state ***/
+    template <int Q>
+    double squared_magnetization(const std::array<int, Q> &count, const int nsite)
+    {
+        double m[Q];
+        for (int i = 0; i < Q; i++)
+        {
+            m[i] = count[i] / static_cast<double>(nsite);
+        }
+        double m2 = 0.0;
+        for (int i = 0; i < Q; i++)
+        {
+            m2 += m[i] * m[i];
+        }
+        for (int i = 0; i < Q - 1; i++)
+        {
+            for (int j = i + 1; j < Q; j++)
+            {
+                m2 -= 2.0 * m[i] * m[j] / (Q - 1);
+            }
+        }
+        return m2;
+    }
+
+    template <class Lattice>
+    double calc_squared_magnetization(const Lattice &spin)
+    {
+        return squared_magnetization<Lattice::Model::Q>(calc_state_histogram(spin), Lattice::nsite);
+    }
+
+    /*******************************************************************/
+    /*** Running totals of a configuration, built once in O(N) and    ***/
+    /*** kept up to date by the updates that take a RunningTotals *:  ***/
+    /***   bond sum   sum_<ij> bond(s_i, s_j)                         ***/
+    /***   site sum   sum_i site(s_i)                                 ***/
+    /***   histogram  N_a = number of sites in state a                ***/
+    /*** so a measurement costs O(1) or O(Q) instead of a full scan.  ***/
+    /*******************************************************************/
+    template <class Model>
+    class RunningTotals
+    {
+    public:
+        static constexpr int Q = Model::Q;
+
+        template <class Lattice>
+        explicit RunningTotals(const Lattice &spin) { rebuild(spin); }
+
+        template <class Lattice>
+        void rebuild(const Lattice &spin)
+        {
+            nsite = Lattice::nsite;
+            bond_sum = 0e0;
+            site_sum = 0e0;
+            count.fill(0);
+            for (int i = 0; i != Lattice::nsite; i++)
+            {
+                const int s = spin[i];
+                count[s] += 1;
+                site_sum += Model::site(s);
+                bond_sum += Model::bond(s, spin[Lattice::xp(i)]) + Model::bond(s, spin[Lattice::yp(i)]);
+            }
+        }
+
+        // one site went from state a to state b; bond_change = sum_k bond(b, n_k) - bond(a, n_k)
+        void change(const int a, const int b, const double bond_change)
+        {
+            count[a] -= 1;
+            count[b] += 1;
+            site_sum += Model::site(b) - Model::site(a);
+            bond_sum += bond_change;
+        }
+
+        // n sites went from a to b; bond_change summed over the bonds leaving the cluster
+        void move(const int a, const int b, const int n, const double bond_change)
+        {
+            count[a] -= n;
+            count[b] += n;
+            site_sum += n * (Model::site(b) - Model::site(a));
+            bond_sum += bond_change;
+        }
+
+        double energy(const double coupling_J, const double coupling_h = 0e0) const { return -(bond_sum * coupling_J + site_sum * coupling_h); }
+        double bond() const { return bond_sum; }
+        int total_spin() const
+        {
+            int total = 0;
+            for (int a = 0; a != Q; a++)
+            {
+                total += count[a] * Model::value(a);
+            }
+            return total;
+        }
+        double squared_magnetization() const { return mcmc::squared_magnetization<Q>(count, nsite); }
+
+        int operator[](const int a) const { return count[a]; }
+        int max() const
+        {
+            int largest = count[0];
+            for (int a = 1; a != Q; a++)
+            {
+                largest = count[a] > largest ? count[a] : largest;
+            }
+            return largest;
+        }
+        int size() const { return nsite; }
+
+    private:
+        double bond_sum = 0e0;
+        double site_sum = 0e0;
+        std::array<int, Q> count{};
+        int nsite = 0;
+    };
+
+    /*** Potts order parameter (Q max_a N_a / N - 1) / (Q - 1), O(Q) per sample ***/
+    template <class Model>
+    double calc_order_parameter(const RunningTotals<Model> &totals)
+    {
+        constexpr int Q = Model::Q;
+        return (Q * totals.max() / static_cast<double>(totals.size()) - 1e0) / (Q - 1);
+    }
+}
+
+#endif
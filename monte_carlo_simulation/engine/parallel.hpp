@@ -0,0 +1,421 @@
+#ifndef MCMC_PARALLEL_HPP
+#define MCMC_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "storage.hpp"
+#include "random.hpp"
+#include "checkerboard.hpp"
+#include "acceptance.hpp"
+#include "observables.hpp"
+
+namespace mcmc
+{
+    /*******************************************************************/
+    /*** OpenMP strip-decomposed checkerboard sweep.                 ***/
+    /*** Update is a row kernel (CheckerboardMetropolis or           ***/
+    /*** QStateCheckerboardMetropolis): every thread owns a strip of ***/
+    /*** whole rows and updates colour 0 of its strip, then, after a ***/
+    /*** barrier, colour 1. Rows of one colour only read the other   ***/
+    /*** colour, so a phase has no data races. Strip boundaries are  ***/
+    /*** rounded to rows that start on a cache line.                 ***/
+    /*** Strip k draws from its own stream: a copy of the caller's   ***/
+    /*** generator moved (k + 1) * 2^192 draws ahead by long_jump(). ***/
+    /*** Without -fopenmp it runs as one thread.                     ***/
+    /*******************************************************************/
+    template <class Update, class Rng = Xoshiro256ss>
+    class ParallelCheckerboard
+    {
+    public:
+        using Lattice = typename Update::Lattice;
+        static constexpr int L = Lattice::L;
+
+        ParallelCheckerboard(const double coupling_J, const double coupling_h, const double temperature)
+            : update(coupling_J, coupling_h, temperature)
+        {
+#ifdef _OPENMP
+            nthread = omp_get_max_threads();
+#endif
+            nthread = nthread < L ? nthread : L;
+            // rows per cache line of the row kernel's storage
+            int unit = 1;
+            while ((unit * Update::row_bytes) % CacheAlignedAllocator<char>::alignment != 0 && unit < L)
+            {
+                unit++;
+            }
+            first_row.resize(nthread + 1);
+            for (int t = 0; t <= nthread; t++)
+            {
+                const int ix = (int)((long)L * t / nthread);
+                first_row[t] = t == nthread ? L : ix / unit * unit;
+            }
+            random.resize(nthread);
+            for (auto &buffer : random)
+            {
+                buffer.resize(Update::nrandom);
+            }
+        }
+
+        void set_temperature(const double T) { update.set_temperature(T); }
+        double get_temperature() const { return update.get_temperature(); }
+        int get_num_threads() const { return nthread; }
+
+        // the strip streams, which run apart from the caller's generator after the first sweep
+        template <class Archive>
+        void checkpoint(Archive &archive)
+        {
+            std::uint64_t n = streams.size();
+            archive(n);
+            if constexpr (Archive::loading)
+            {
+                if (n != 0 && n != (std::uint64_t)nthread)
+                {
+                    throw std::runtime_error("written with " + std::to_string(n) + " threads, not " + std::to_string(nthread));
+                }
+                streams.assign(n, Rng(0));
+            }
+            for (Rng &stream : streams)
+            {
+                archive(stream);
+            }
+        }
+
+        void sweep(Lattice &spin, Rng &rng)
+        {
+            split_streams(rng);
+#pragma omp parallel num_threads(nthread)
+            {
+                int t = 0;
+                int nteam = 1;
+#ifdef _OPENMP
+                t = omp_get_thread_num();
+                nteam = omp_get_num_threads();
+#endif
+                std::uint32_t *r = random[t].data();
+                for (int c = 0; c != 2; c++)
+                {
+                    // strip k belongs to thread k, unless the runtime gave us fewer threads
+                    for (int k = t; k < nthread; k += nteam)
+                    {
+                        for (int ix = first_row[k]; ix != first_row[k + 1]; ix++)
+                        {
+                            streams[k].fill(r, Update::nrandom);
+                            update.update_row(spin, c, ix, r);
+                        }
+                    }
+#pragma omp barrier
+#pragma omp single
+                    spin.refresh();
+                }
+            }
+        }
+
+    private:
+        // one stream per strip, split off the caller's generator on first use
+        void split_streams(const Rng &rng)
+        {
+            if (!streams.empty())
+            {
+                return;
+            }
+            Rng stream = rng;
+            for (int k = 0; k != nthread; k++)
+            {
+                stream.long_jump();
+                streams.push_back(stream);
+            }
+        }
+
+        Update update;
+        std::vector<Rng> streams;
+        int nthread = 1;
+        std::vector<int> first_row;
+        std::vector<aligned_vector<std::uint32_t>> random;
+    };
+
+    /*******************************************************************/
+    /*** OpenMP Swendsen-Wang update (Ising, Potts; h = 0 only).     ***/
+    /*** Every thread owns a strip of whole rows:                    ***/
+    /***   1. places the bonds of its rows and labels the strip with ***/
+    /***      a plain union-find (roots = smallest site)             ***/
+    /***   2. joins the bonds from its last row into the next strip  ***/
+    /***      with a lock-free union (compare-and-swap on the root)  ***/
+    /***   3. draws a new state for every root in the strip          ***/
+    /***   4. copies the state of its root into every site           ***/
+    /*** Roots do not depend on the thread schedule, so a run is     ***/
+    /*** reproducible for a given number of threads. Strip k draws   ***/
+    /*** from its own long_jump() stream. Needs IntStorage or        ***/
+    /*** ByteStorage.                                                ***/
+    /*******************************************************************/
+    template <class Lattice, class Rng = Xoshiro256ss>
+    class ParallelSwendsenWang
+    {
+    public:
+        using Model = typename Lattice::Model;
+        static constexpr int Q = Model::Q;
+        static constexpr int L = Lattice::L;
+        static constexpr int nsite = Lattice::nsite;
+
+        ParallelSwendsenWang(const double coupling_J, const double temperature)
+            : coupling_J(coupling_J), bond_x(nsite), bond_y(nsite), parent(nsite), new_state(nsite)
+        {
+#ifdef _OPENMP
+            nthread = omp_get_max_threads();
+#endif
+            nthread = nthread < L ? nthread : L;
+            first_row.resize(nthread + 1);
+            for (int t = 0; t <= nthread; t++)
+            {
+                first_row[t] = (int)((long)L * t / nthread);
+            }
+            random.resize(nthread);
+            for (auto &buffer : random)
+            {
+                buffer.resize(2 * L);
+            }
+            n_root.resize(nthread);
+            set_temperature(temperature);
+        }
+
+        void set_temperature(const double T)
+        {
+            temperature = T;
+            threshold = acceptance_threshold(1e0 - std::exp(-Model::wolff_bond * coupling_J / temperature));
+        }
+        double get_temperature() const { return temperature; }
+        int get_num_threads() const { return nthread; }
+
+        // one update of every cluster; returns the number of clusters.
+        // totals (optional) are rebuilt
+        int step(Lattice &spin, Rng &rng, RunningTotals<Model> *totals = nullptr)
+        {
+            split_streams(rng);
+#pragma omp parallel num_threads(nthread)
+            {
+                int t = 0;
+                int nteam = 1;
+#ifdef _OPENMP
+                t = omp_get_thread_num();
+                nteam = omp_get_num_threads();
+#endif
+                for (int k = t; k < nthread; k += nteam)
+                {
+                    label_strip(spin, k);
+                }
+#pragma omp barrier
+                for (int k = t; k < nthread; k += nteam)
+                {
+                    merge_strip(k);
+                }
+#pragma omp barrier
+                for (int k = t; k < nthread; k += nteam)
+                {
+                    draw_states(k);
+                }
+#pragma omp barrier
+                for (int k = t; k < nthread; k += nteam)
+                {
+                    set_strip(spin, k);
+                }
+            }
+            spin.refresh();
+            if (totals)
+            {
+                totals->rebuild(spin);
+            }
+            n_cluster = 0;
+            for (const int n : n_root)
+            {
+                n_cluster += n;
+            }
+            return n_cluster;
+        }
+
+        void sweep(Lattice &spin, Rng &rng, RunningTotals<Model> *totals = nullptr)
+        {
+            step(spin, rng, totals);
+        }
+
+        int cluster_count() const { return n_cluster; }
+
+    private:
+        // one stream per strip, split off the caller's generator on first use
+        void split_streams(const Rng &rng)
+        {
+            if (!streams.empty())
+            {
+                return;
+            }
+            Rng stream = rng;
+            for (int k = 0; k != nthread; k++)
+            {
+                stream.long_jump();
+                streams.push_back(stream);
+            }
+        }
+
+        // bonds of strip k and its clusters, ignoring the bonds into the next strip
+        void label_strip(const Lattice &spin, const int k)
+        {
+            const int begin = first_row[k];
+            const int end = first_row[k + 1];
+            for (int i = begin * L; i != end * L; i++)
+            {
+                parent[i].store(i, std::memory_order_relaxed);
+            }
+            const std::uint32_t *r = random[k].data();
+            for (int ix = begin; ix != end; ix++)
+            {
+                const auto *s = spin.row(ix);
+                const auto *down = spin.row(ix + 1 == L ? 0 : ix + 1);
+                std::uint8_t *bx = bond_x.data() + ix * L;
+                std::uint8_t *by = bond_y.data() + ix * L;
+                streams[k].fill(random[k].data(), 2 * L);
+                for (int iy = 0; iy != L; iy++)
+                {
+                    bx[iy] = (s[iy] == down[iy]) & ((std::int32_t)(r[iy] >> 1) <= threshold);
+                }
+                for (int iy = 0; iy != L - 1; iy++)
+                {
+                    by[iy] = (s[iy] == s[iy + 1]) & ((std::int32_t)(r[L + iy] >> 1) <= threshold);
+                }
+                by[L - 1] = (s[L - 1] == s[0]) & ((std::int32_t)(r[2 * L - 1] >> 1) <= threshold);
+
+                for (int iy = 0; iy != L; iy++)
+                {
+                    const int i = ix * L + iy;
+                    if (bx[iy] && ix + 1 != end)
+                    {
+                        unite_local(i, i + L);
+                    }
+                    if (by[iy])
+                    {
+                        unite_local(i, ix * L + (iy + 1 == L ? 0 : iy + 1));
+                    }
+                }
+            }
+            // parent[i] <= i, so one forward pass flattens the strip
+            for (int i = begin * L; i != end * L; i++)
+            {
+                const int p = parent[i].load(std::memory_order_relaxed);
+                parent[i].store(parent[p].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+        }
+
+        // bonds from the last row of strip k into the first row of the next one
+        void merge_strip(const int k)
+        {
+            const int ix = first_row[k + 1] - 1;
+            const int down = (ix + 1 == L ? 0 : ix + 1) * L;
+            for (int iy = 0; iy != L; iy++)
+            {
+                if (bond_x[ix * L + iy])
+                {
+                    unite_shared(ix * L + iy, down + iy);
+                }
+            }
+        }
+
+        void draw_states(const int k)
+        {
+            n_root[k] = 0;
+            for (int i = first_row[k] * L; i != first_row[k + 1] * L; i++)
+            {
+                if (parent[i].load(std::memory_order_relaxed) == i)
+                {
+                    new_state[i] = streams[k].below(Q);
+                    n_root[k] = n_root[k] + 1;
+                }
+            }
+        }
+
+        void set_strip(Lattice &spin, const int k)
+        {
+            for (int ix = first_row[k]; ix != first_row[k + 1]; ix++)
+            {
+                auto *s = spin.row(ix);
+                for (int iy = 0; iy != L; iy++)
+                {
+                    s[iy] = new_state[find(ix * L + iy)];
+                }
+            }
+        }
+
+        // path halving; another thread may halve the same path, but every
+        // value written is still an ancestor, so the result is the same
+        int find(int i)
+        {
+            int p = parent[i].load(std::memory_order_relaxed);
+            while (p != i)
+            {
+                const int grand = parent[p].load(std::memory_order_relaxed);
+                parent[i].store(grand, std::memory_order_relaxed);
+                i = grand;
+                p = parent[i].load(std::memory_order_relaxed);
+            }
+            return i;
+        }
+
+        // only this thread touches the strip during step 1
+        void unite_local(const int i, const int j)
+        {
+            const int a = find(i);
+            const int b = find(j);
+            if (a < b)
+            {
+                parent[b].store(a, std::memory_order_relaxed);
+            }
+            else if (b < a)
+            {
+                parent[a].store(b, std::memory_order_relaxed);
+            }
+        }
+
+        // links the larger root under the smaller one iff it is still a root
+        void unite_shared(const int i, const int j)
+        {
+            while (true)
+            {
+                int a = find(i);
+                int b = find(j);
+                if (a == b)
+                {
+                    return;
+                }
+                if (b < a)
+                {
+                    std::swap(a, b);
+                }
+                int expected = b;
+                if (parent[b].compare_exchange_weak(expected, a))
+                {
+                    return;
+                }
+            }
+        }
+
+        double coupling_J;
+        double temperature = 1e0;
+        std::int32_t threshold = 0;
+        int n_cluster = 0;
+        int nthread = 1;
+        std::vector<int> first_row;
+        std::vector<std::uint8_t> bond_x;
+        std::vector<std::uint8_t> bond_y;
+        std::vector<std::atomic<int>> parent;
+        std::vector<int> new_state; // new state of each cluster, indexed by its root
+        std::vector<int> n_root;    // roots per strip
+        std::vector<Rng> streams;
+        std::vector<aligned_vector<std::uint32_t>> random;
+    };
+}
+
+#endif
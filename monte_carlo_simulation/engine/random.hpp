@@ -0,0 +1,154 @@
+#ifndef MCMC_RANDOM_HPP
+#define MCMC_RANDOM_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <string>
+
+namespace mcmc
+{
+    /*******************************************************************/
+    /*** xoshiro256** (Blackman & Vigna), 64-bit output.              ***/
+    /*** Rng(seed, stream) is stream number `stream` of the seed: the ***/
+    /*** splitmix64-expanded state jumped ahead stream * 2^128 draws, ***/
+    /*** so threads, replicas and temperatures never overlap.         ***/
+    /*******************************************************************/
+    class Xoshiro256ss
+    {
+    public:
+        explicit Xoshiro256ss(const std::uint64_t seed, const int stream = 0) : seed_(seed), stream_(stream)
+        {
+            std::uint64_t z = seed;
+            for (int k = 0; k != 4; k++)
+            {
+                s[k] = splitmix64(z);
+            }
+            for (int k = 0; k != stream; k++)
+            {
+                jump();
+            }
+        }
+
+        std::uint64_t next_u64()
+        {
+            const std::uint64_t result = rotl(s[1] * 5, 7) * 9;
+            const std::uint64_t t = s[1] << 17;
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= t;
+            s[3] = rotl(s[3], 45);
+            return result;
+        }
+        std::uint32_t next_u32() { return (std::uint32_t)(next_u64() >> 32); }
+
+        // uniform in [0,1) with 53 random bits
+        double uniform() { return (next_u64() >> 11) * (1.0 / 9007199254740992.0); }
+        // uniform integer in [0,n)
+        int below(const int n) { return (int)(((std::uint64_t)next_u32() * (std::uint64_t)n) >> 32); }
+
+        // bulk fill for the vector kernels: both halves of every 64-bit draw
+        void fill(std::uint32_t *buf, const int n)
+        {
+            int k = 0;
+            for (; k + 2 <= n; k += 2)
+            {
+                const std::uint64_t r = next_u64();
+                buf[k] = (std::uint32_t)r;
+                buf[k + 1] = (std::uint32_t)(r >> 32);
+            }
+            if (k < n)
+            {
+                buf[k] = next_u32();
+            }
+        }
+        void fill(std::uint64_t *buf, const int n)
+        {
+            for (int k = 0; k != n; k++)
+            {
+                buf[k] = next_u64();
+            }
+        }
+
+        // advance by 2^128 draws
+        void jump() { apply({0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL}); }
+        // advance by 2^192 draws: 2^64 streams of 2^64 jumps each
+        void long_jump() { apply({0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL}); }
+
+        std::uint64_t seed() const { return seed_; }
+        int stream() const { return stream_; }
+
+    private:
+        static std::uint64_t rotl(const std::uint64_t x, const int k) { return (x << k) | (x >> (64 - k)); }
+
+        static std::uint64_t splitmix64(std::uint64_t &x)
+        {
+            x += 0x9e3779b97f4a7c15ULL;
+            std::uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        void apply(const std::uint64_t (&polynomial)[4])
+        {
+            std::uint64_t t[4] = {0, 0, 0, 0};
+            for (int w = 0; w != 4; w++)
+            {
+                for (int b = 0; b != 64; b++)
+                {
+                    if ((polynomial[w] >> b) & 1)
+                    {
+                        for (int k = 0; k != 4; k++)
+                        {
+                            t[k] ^= s[k];
+                        }
+                    }
+                    next_u64();
+                }
+            }
+            for (int k = 0; k != 4; k++)
+            {
+                s[k] = t[k];
+            }
+        }
+
+        std::uint64_t seed_;
+        int stream_;
+        std::uint64_t s[4];
+    };
+
+    /*** seed = 0 -> a fresh seed from std::random_device and the clock; otherwise seed itself ***/
+    inline std::uint64_t make_seed(const std::uint64_t seed = 0)
+    {
+        if (seed != 0)
+        {
+            return seed;
+        }
+        std::random_device device;
+        const std::uint64_t entropy = ((std::uint64_t)device() << 32) ^ device();
+        return entropy ^ (std::uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    }
+
+    /*** appends "filename seed stream" to seed_log.txt next to filename (thread safe) ***/
+    inline void log_seed(const std::string &filename, const std::uint64_t seed, const int stream)
+    {
+        static std::mutex mutex;
+        const std::lock_guard<std::mutex> lock(mutex);
+        const std::string directory = filename.substr(0, filename.find_last_of('/') + 1);
+        std::ofstream log(directory + "seed_log.txt", std::ios::app);
+        log << filename << ' ' << seed << ' ' << stream << '\n';
+    }
+
+    template <class Rng>
+    void log_seed(const std::string &filename, const Rng &rng)
+    {
+        log_seed(filename, rng.seed(), rng.stream());
+    }
+}
+
+#endif
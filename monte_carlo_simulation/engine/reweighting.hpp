@@ -0,0 +1,209 @@
+#ifndef MCMC_REWEIGHTING_HPP
+#define MCMC_REWEIGHTING_HPP
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace mcmc
+{
+    /*** reweighted averages at one temperature (per site, like the calc_parameter drivers) ***/
+    struct ReweightedEstimate
+    {
+        double temperature;
+        double energy;                  // <E> / N
+        double specific_heat;           // (<E^2> - <E>^2) / (T^2 N)
+        double magnetization;           // <|M|> / N
+        double magnetic_susceptibility; // (<M^2> - <|M|>^2) / (T N)
+        double binder_ratio;            // <M^4> / <M^2>^2
+    };
+
+    /*******************************************************************/
+    /*** Multiple-histogram (Ferrenberg-Swendsen / WHAM)             ***/
+    /*** reweighting. Every run k at temperature T_k contributes N_k ***/
+    /*** samples (E, M). solve() iterates the self-consistency       ***/
+    /*** equations                                                   ***/
+    /***   Z_k = sum_x exp(-E_x / T_k) / D(E_x)                      ***/
+    /***   D(E) = sum_l N_l exp(-E / T_l) / Z_l                      ***/
+    /*** over all samples x of all runs, in log space, until ln Z_k  ***/
+    /*** stops moving. at(T) then weights every sample by            ***/
+    /*** exp(-E_x / T) / D(E_x), so any T between the runs can be    ***/
+    /*** evaluated as long as neighbouring energy histograms         ***/
+    /*** overlap. The sums over samples run on the OpenMP threads.   ***/
+    /*******************************************************************/
+    class MultiHistogram
+    {
+    public:
+        explicit MultiHistogram(const int nsite) : nsite(nsite) {}
+
+        // one run: energy and magnetization (total, not per site) of every sample
+        void add_run(const double temperature, const std::vector<double> &energy, const std::vector<double> &magnetization)
+        {
+            const int k = (int)beta.size();
+            beta.push_back(1e0 / temperature);
+            log_count.push_back(std::log((double)energy.size()));
+            log_z.push_back(0e0);
+            for (std::size_t n = 0; n != energy.size(); n++)
+            {
+                sample_energy.push_back(energy[n]);
+                sample_magnetization.push_back(magnetization[n]);
+                sample_run.push_back(k);
+            }
+        }
+
+        // returns the number of iterations; ln Z_0 is fixed to 0
+        int solve(const double tolerance = 1e-10, const int max_iter = 100000)
+        {
+            const int nrun = (int)beta.size();
+            const long int nsample = (long int)sample_energy.size();
+            log_denominator.assign(nsample, 0e0);
+            // start from single-histogram estimates: ln Z_k - ln Z_k-1 from the run at T_k-1
+            for (int k = 1; k < nrun; k++)
+            {
+                std::vector<double> exponent;
+                for (long int n = 0; n != nsample; n++)
+                {
+                    if (sample_run[n] == k - 1)
+                    {
+                        exponent.push_back(-(beta[k] - beta[k - 1]) * sample_energy[n]);
+                    }
+                }
+                log_z[k] = log_z[k - 1] + log_sum_exp(exponent) - log_count[k - 1];
+            }
+
+            int iter = 0;
+            while (iter < max_iter)
+            {
+                iter++;
+                update_denominator();
+                std::vector<double> next(nrun);
+                for (int k = 0; k != nrun; k++)
+                {
+                    next[k] = log_weight_sum(beta[k]);
+                }
+                double change = 0e0;
+                for (int k = 0; k != nrun; k++)
+                {
+                    const double value = next[k] - next[0];
+                    change = std::fmax(change, std::fabs(value - log_z[k]));
+                    log_z[k] = value;
+                }
+                if (change < tolerance)
+                {
+                    break;
+                }
+            }
+            update_denominator();
+            return iter;
+        }
+
+        // ln Z(T_k) relative to the first run
+        double get_log_partition(const int k) const { return log_z[k]; }
+
+        ReweightedEstimate at(const double temperature) const
+        {
+            const double b = 1e0 / temperature;
+            const long int nsample = (long int)sample_energy.size();
+            // shift every exponent by the largest one
+            double shift = -std::numeric_limits<double>::infinity();
+            for (long int n = 0; n != nsample; n++)
+            {
+                shift = std::fmax(shift, -b * sample_energy[n] - log_denominator[n]);
+            }
+            double w0 = 0e0, e1 = 0e0, e2 = 0e0, m1 = 0e0, m2 = 0e0, m4 = 0e0;
+#pragma omp parallel for reduction(+ : w0, e1, e2, m1, m2, m4)
+            for (long int n = 0; n < nsample; n++)
+            {
+                const double w = std::exp(-b * sample_energy[n] - log_denominator[n] - shift);
+                const double E = sample_energy[n];
+                const double M = std::fabs(sample_magnetization[n]);
+                w0 += w;
+                e1 += w * E;
+                e2 += w * E * E;
+                m1 += w * M;
+                m2 += w * M * M;
+                m4 += w * M * M * M * M;
+            }
+            e1 /= w0;
+            e2 /= w0;
+            m1 /= w0;
+            m2 /= w0;
+            m4 /= w0;
+            ReweightedEstimate estimate;
+            estimate.temperature = temperature;
+            estimate.energy = e1 / nsite;
+            estimate.specific_heat = (e2 - e1 * e1) * b * b / nsite;
+            estimate.magnetization = m1 / nsite;
+            estimate.magnetic_susceptibility = (m2 - m1 * m1) * b / nsite;
+            estimate.binder_ratio = m4 / (m2 * m2);
+            return estimate;
+        }
+
+    private:
+        static double log_sum_exp(const std::vector<double> &x)
+        {
+            double largest = -std::numeric_limits<double>::infinity();
+            for (const double v : x)
+            {
+                largest = std::fmax(largest, v);
+            }
+            double sum = 0e0;
+            for (const double v : x)
+            {
+                sum += std::exp(v - largest);
+            }
+            return largest + std::log(sum);
+        }
+
+        // ln D(E_x) for every sample
+        void update_denominator()
+        {
+            const int nrun = (int)beta.size();
+            const long int nsample = (long int)sample_energy.size();
+#pragma omp parallel for
+            for (long int n = 0; n < nsample; n++)
+            {
+                double largest = -std::numeric_limits<double>::infinity();
+                for (int l = 0; l != nrun; l++)
+                {
+                    largest = std::fmax(largest, log_count[l] - beta[l] * sample_energy[n] - log_z[l]);
+                }
+                double sum = 0e0;
+                for (int l = 0; l != nrun; l++)
+                {
+                    sum += std::exp(log_count[l] - beta[l] * sample_energy[n] - log_z[l] - largest);
+                }
+                log_denominator[n] = largest + std::log(sum);
+            }
+        }
+
+        // ln sum_x exp(-b E_x) / D(E_x)
+        double log_weight_sum(const double b) const
+        {
+            const long int nsample = (long int)sample_energy.size();
+            double shift = -std::numeric_limits<double>::infinity();
+            for (long int n = 0; n != nsample; n++)
+            {
+                shift = std::fmax(shift, -b * sample_energy[n] - log_denominator[n]);
+            }
+            double sum = 0e0;
+#pragma omp parallel for reduction(+ : sum)
+            for (long int n = 0; n < nsample; n++)
+            {
+                sum += std::exp(-b * sample_energy[n] - log_denominator[n] - shift);
+            }
+            return shift + std::log(sum);
+        }
+
+        int nsite;
+        std::vector<double> beta;
+        std::vector<double> log_count; // ln N_k
+        std::vector<double> log_z;     // ln Z_k
+        std::vector<double> sample_energy;
+        std::vector<double> sample_magnetization;
+        std::vector<int> sample_run;
+        std::vector<double> log_denominator; // ln D(E_x)
+    };
+}
+
+#endif
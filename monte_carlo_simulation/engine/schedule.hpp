@@ -0,0 +1,104 @@
+#ifndef MCMC_SCHEDULE_HPP
+#define MCMC_SCHEDULE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace mcmc
+{
+    /*** relative cost of a run at temperature T: grows towards t_critical ***/
+    inline double critical_slowing_cost(const double T, const double t_critical)
+    {
+        return 1e0 / (std::abs(T - t_critical) + 0.05);
+    }
+
+    /*******************************************************************/
+    /*** Runs task(k), k = 0..ntask-1, as independent tasks on the    ***/
+    /*** OpenMP threads. The tasks are dealt out most expensive first ***/
+    /*** (by cost[k]) into one deque per thread; a thread whose deque ***/
+    /*** runs dry steals the most expensive task left in another      ***/
+    /*** deque. task(k) must only write its own results.              ***/
+    /*** Without -fopenmp the tasks run one after another, most       ***/
+    /*** expensive first.                                             ***/
+    /*******************************************************************/
+    template <class Task>
+    void run_tasks(const std::vector<double> &cost, Task task)
+    {
+        const int ntask = (int)cost.size();
+        std::vector<int> order(ntask);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](const int a, const int b)
+                         { return cost[a] > cost[b]; });
+
+        int nthread = 1;
+#ifdef _OPENMP
+        nthread = omp_get_max_threads();
+#endif
+        nthread = std::max(1, std::min(nthread, ntask));
+        std::vector<std::deque<int>> queue(nthread);
+        std::vector<std::mutex> lock(nthread);
+        for (int k = 0; k != ntask; k++)
+        {
+            queue[k % nthread].push_back(order[k]);
+        }
+
+        // front of deque t (its most expensive task), or -1
+        auto pop = [&](const int t)
+        {
+            const std::lock_guard<std::mutex> guard(lock[t]);
+            if (queue[t].empty())
+            {
+                return -1;
+            }
+            const int k = queue[t].front();
+            queue[t].pop_front();
+            return k;
+        };
+
+#pragma omp parallel num_threads(nthread)
+        {
+            int t = 0;
+#ifdef _OPENMP
+            t = omp_get_thread_num();
+#endif
+            while (true)
+            {
+                int k = pop(t);
+                while (k < 0)
+                {
+                    // steal from the deque whose front costs most
+                    int victim = -1;
+                    double largest = -1e0;
+                    for (int v = 0; v != nthread; v++)
+                    {
+                        const std::lock_guard<std::mutex> guard(lock[v]);
+                        if (!queue[v].empty() && cost[queue[v].front()] > largest)
+                        {
+                            largest = cost[queue[v].front()];
+                            victim = v;
+                        }
+                    }
+                    if (victim < 0)
+                    {
+                        break; // nothing left anywhere
+                    }
+                    k = pop(victim);
+                }
+                if (k < 0)
+                {
+                    break;
+                }
+                task(k);
+            }
+        }
+    }
+}
+
+#endif
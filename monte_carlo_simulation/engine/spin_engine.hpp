@@ -0,0 +1,18 @@
+#ifndef MCMC_SPIN_ENGINE_HPP
+#define MCMC_SPIN_ENGINE_HPP
+
+/*****************************************************/
+/*** Header-only engine for the 2d spin models     ***/
+/***   model  : Ising, Potts<Q>, Clock<Q>          ***/
+/***   lattice: SquareLattice<Model, L>            ***/
+/***   update : Metropolis, HeatBath, Wolff,       ***/
+/***            SwendsenWang                       ***/
+/*****************************************************/
+#include "spin_models.hpp"
+#include "lattice.hpp"
+#include "random.hpp"
+#include "updates.hpp"
+#include "observables.hpp"
+#include "config_io.hpp"
+
+#endif
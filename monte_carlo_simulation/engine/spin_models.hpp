@@ -0,0 +1,165 @@
+#ifndef MCMC_SPIN_MODELS_HPP
+#define MCMC_SPIN_MODELS_HPP
+
+#include <cmath>
+
+/********************************************************/
+/*** Model policies for the 2d spin-model engine      ***/
+/*** Every site holds a state index 0..Q-1 and        ***/
+/*** E = -J sum_<ij> bond(s_i,s_j) - h sum_i site(s_i) ***/
+/********************************************************/
+namespace mcmc
+{
+    constexpr double pi = 3.141592653589793;
+
+    /*** cos usable in constant expressions (Taylor series after reduction to [-pi, pi]) ***/
+    constexpr double constexpr_cos(double x)
+    {
+        while (x > pi)
+        {
+            x -= 2 * pi;
+        }
+        while (x < -pi)
+        {
+            x += 2 * pi;
+        }
+        double term = 1e0;
+        double sum = 1e0;
+        for (int k = 1; k != 30; k++)
+        {
+            term *= -x * x / ((2 * k - 1) * (2 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    /*** Ising: state 0 <-> spin +1, state 1 <-> spin -1 ***/
+    struct Ising
+    {
+        static constexpr int Q = 2;
+        static constexpr const char *name = "Ising";
+
+        static constexpr int value(const int state) { return 1 - 2 * state; }
+        static constexpr int state(const int value) { return (1 - value) / 2; }
+
+        static constexpr double bond(const int a, const int b) { return value(a) * value(b); }
+        static constexpr double site(const int a) { return value(a); }
+
+        // sum_k bond(a, n_k) - bond(b, n_k) over the four neighbours
+        static constexpr int bond_change(const int a, const int b, const int (&n)[4])
+        {
+            return (value(a) - value(b)) * (value(n[0]) + value(n[1]) + value(n[2]) + value(n[3]));
+        }
+
+        // single-site proposal: always the flipped spin
+        template <class Rng>
+        static int propose(const int a, Rng &)
+        {
+            return a ^ 1;
+        }
+
+        // Wolff: bond(a,a) - bond(a,b) for b != a
+        static constexpr double wolff_bond = 2.0;
+
+        template <class Rng>
+        static int cluster_state(const int a, Rng &)
+        {
+            return a ^ 1;
+        }
+    };
+
+    /*** Q-state Potts: bond = kronecker_delta(a, b) ***/
+    template <int Q_>
+    struct Potts
+    {
+        static_assert(Q_ >= 2, "Potts model needs Q >= 2");
+        static constexpr int Q = Q_;
+        static constexpr const char *name = "Potts";
+
+        static constexpr int value(const int state) { return state; }
+        static constexpr int state(const int value) { return value; }
+
+        static constexpr double bond(const int a, const int b) { return a == b ? 1.0 : 0.0; }
+        static constexpr double site(const int a) { return a == 0 ? 1.0 : 0.0; }
+
+        static constexpr int bond_change(const int a, const int b, const int (&n)[4])
+        {
+            int sum = 0;
+            for (int k = 0; k != 4; k++)
+            {
+                sum += (a == n[k]) - (b == n[k]);
+            }
+            return sum;
+        }
+
+        // single-site proposal: a uniformly random state (may equal the current one)
+        template <class Rng>
+        static int propose(const int, Rng &rng)
+        {
+            return rng.below(Q);
+        }
+
+        // cluster bonds: bond(a,a) - bond(a,b) for b != a
+        static constexpr double wolff_bond = 1.0;
+
+        // Wolff: a uniformly random state other than a
+        template <class Rng>
+        static int cluster_state(const int a, Rng &rng)
+        {
+            const int b = rng.below(Q - 1);
+            return b < a ? b : b + 1;
+        }
+    };
+
+    /*** Q-state Clock: bond = cos(2 pi (a - b) / Q) ***/
+    template <int Q_>
+    struct Clock
+    {
+        static_assert(Q_ >= 2, "Clock model needs Q >= 2");
+        static constexpr int Q = Q_;
+        static constexpr const char *name = "Clock";
+
+        /*** Q x Q bond energies and Q site energies, built at compile time ***/
+        struct BondTable
+        {
+            double bond[Q][Q];
+            double site[Q];
+            constexpr BondTable() : bond(), site()
+            {
+                for (int a = 0; a != Q; a++)
+                {
+                    for (int b = 0; b != Q; b++)
+                    {
+                        bond[a][b] = constexpr_cos(2 * pi * (a - b) / Q);
+                    }
+                    site[a] = constexpr_cos(2 * pi * a / Q);
+                }
+            }
+        };
+        static constexpr BondTable table{};
+
+        static constexpr int value(const int state) { return state; }
+        static constexpr int state(const int value) { return value; }
+
+        static constexpr double bond(const int a, const int b) { return table.bond[a][b]; }
+        static constexpr double site(const int a) { return table.site[a]; }
+
+        static constexpr double bond_change(const int a, const int b, const int (&n)[4])
+        {
+            double sum = 0e0;
+            for (int k = 0; k != 4; k++)
+            {
+                sum += table.bond[a][n[k]] - table.bond[b][n[k]];
+            }
+            return sum;
+        }
+
+        template <class Rng>
+        static int propose(const int, Rng &rng)
+        {
+            return rng.below(Q);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,468 @@
+#ifndef MCMC_STATISTICS_HPP
+#define MCMC_STATISTICS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace mcmc
+{
+    /*** value with its statistical error ***/
+    struct Estimate
+    {
+        double value;
+        double error;
+    };
+
+    /*******************************************************/
+    /*** Welford's running mean and variance: one pass,  ***/
+    /*** no cancellation between large sums of x and x^2 ***/
+    /*******************************************************/
+    class Welford
+    {
+    public:
+        void add(const double x)
+        {
+            n++;
+            const double delta = x - m;
+            m += delta / n;
+            m2 += delta * (x - m);
+        }
+
+        long int count() const { return n; }
+        double mean() const { return m; }
+        double variance() const { return n > 1 ? m2 / (n - 1) : 0e0; }
+        // error of the mean for independent samples
+        double error() const { return n > 1 ? std::sqrt(variance() / n) : 0e0; }
+
+    private:
+        long int n = 0;
+        double m = 0e0;
+        double m2 = 0e0;
+    };
+
+    /*******************************************************************/
+    /*** Logarithmic binning analysis of a correlated time series.   ***/
+    /*** Level k sees the means of blocks of 2^k samples; a block is ***/
+    /*** finished when its second half arrives: O(log n) memory.     ***/
+    /*** The error of the mean grows with k until the blocks are     ***/
+    /*** longer than the autocorrelation time, then levels off:      ***/
+    /***   tau_int = (error_k / error_0)^2 / 2                       ***/
+    /*** on that plateau (tau_int = 1/2 for independent samples).    ***/
+    /*******************************************************************/
+    class Binning
+    {
+    public:
+        // the plateau is read off the deepest level with at least min_blocks blocks
+        explicit Binning(const long int min_blocks = 128) : min_blocks(min_blocks) {}
+
+        void add(double x)
+        {
+            for (std::size_t k = 0;; k++)
+            {
+                if (k == level.size())
+                {
+                    level.emplace_back();
+                    pending.push_back(0e0);
+                    half.push_back(false);
+                }
+                level[k].add(x);
+                if (!half[k])
+                {
+                    pending[k] = x;
+                    half[k] = true;
+                    return;
+                }
+                x = 0.5 * (pending[k] + x);
+                half[k] = false;
+            }
+        }
+
+        long int count() const { return level.empty() ? 0 : level[0].count(); }
+        double mean() const { return level.empty() ? 0e0 : level[0].mean(); }
+        int levels() const { return (int)level.size(); }
+        // error of the mean from blocks of 2^k samples
+        double error(const int k) const { return level[k].error(); }
+        double error() const { return level.empty() ? 0e0 : error(plateau()); }
+        Estimate estimate() const { return {mean(), error()}; }
+
+        double autocorrelation_time() const
+        {
+            if (level.empty() || level[0].error() == 0e0)
+            {
+                return 0.5;
+            }
+            const double ratio = error() / level[0].error();
+            return 0.5 * ratio * ratio;
+        }
+
+        // every field, for the archives of checkpoint.hpp
+        template <class Archive>
+        void checkpoint(Archive &archive)
+        {
+            archive(min_blocks);
+            archive(level);
+            archive(pending);
+            archive(half);
+        }
+
+    private:
+        int plateau() const
+        {
+            int k = 0;
+            while (k + 1 < (int)level.size() && level[k + 1].count() >= min_blocks)
+            {
+                k++;
+            }
+            return k;
+        }
+
+        long int min_blocks;
+        std::vector<Welford> level;
+        std::vector<double> pending; // first half of the block being filled at level k
+        std::vector<bool> half;
+    };
+
+    /*******************************************************************/
+    /*** Streaming jackknife for functions of the means of K         ***/
+    /*** observables (chi, C, Binder ratio, ...). Samples go into at ***/
+    /*** most nbin bins of equal size; when all are full, neighbours ***/
+    /*** are merged and the bin size doubles: O(nbin) memory, and    ***/
+    /*** the bins grow past any autocorrelation time. Only           ***/
+    /*** completed bins enter the estimate.                          ***/
+    /*******************************************************************/
+    template <int K>
+    class Jackknife
+    {
+    public:
+        using Sample = std::array<double, K>;
+
+        explicit Jackknife(const int nbin = 64) : capacity(nbin - nbin % 2) {}
+
+        void add(const Sample &x)
+        {
+            nfill++;
+            for (int i = 0; i != K; i++)
+            {
+                current[i] += (x[i] - current[i]) / nfill;
+            }
+            if (nfill < bin_size)
+            {
+                return;
+            }
+            bin.push_back(current);
+            current.fill(0e0);
+            nfill = 0;
+            if ((int)bin.size() == capacity)
+            {
+                for (int b = 0; b != capacity / 2; b++)
+                {
+                    for (int i = 0; i != K; i++)
+                    {
+                        bin[b][i] = 0.5 * (bin[2 * b][i] + bin[2 * b + 1][i]);
+                    }
+                }
+                bin.resize(capacity / 2);
+                bin_size *= 2;
+            }
+        }
+
+        long int count() const { return (long int)bin.size() * bin_size; }
+        int bins() const { return (int)bin.size(); }
+
+        // f(mean) -> double, with the jackknife error over the completed bins
+        template <class F>
+        Estimate estimate(F f) const
+        {
+            const int n = (int)bin.size();
+            Sample total{};
+            for (const Sample &b : bin)
+            {
+                for (int i = 0; i != K; i++)
+                {
+                    total[i] += b[i];
+                }
+            }
+            Sample mean;
+            for (int i = 0; i != K; i++)
+            {
+                mean[i] = n ? total[i] / n : 0e0;
+            }
+            if (n < 2)
+            {
+                return {f(mean), 0e0};
+            }
+            std::vector<double> value(n);
+            double average = 0e0;
+            for (int b = 0; b != n; b++)
+            {
+                Sample leave_out;
+                for (int i = 0; i != K; i++)
+                {
+                    leave_out[i] = (total[i] - bin[b][i]) / (n - 1);
+                }
+                value[b] = f(leave_out);
+                average += value[b] / n;
+            }
+            double variance = 0e0;
+            for (int b = 0; b != n; b++)
+            {
+                variance += (value[b] - average) * (value[b] - average);
+            }
+            return {f(mean), std::sqrt(variance * (n - 1) / n)};
+        }
+
+        // plain mean of observable i
+        Estimate estimate(const int i) const
+        {
+            return estimate([i](const Sample &m)
+                            { return m[i]; });
+        }
+
+        template <class Archive>
+        void checkpoint(Archive &archive)
+        {
+            archive(capacity);
+            archive(bin_size);
+            archive(bin);
+            archive(current);
+            archive(nfill);
+        }
+
+    private:
+        int capacity;
+        long int bin_size = 1;
+        std::vector<Sample> bin;
+        Sample current{};
+        long int nfill = 0;
+    };
+
+    /*** true when the error is at most relative times |value| ***/
+    inline bool within(const Estimate &estimate, const double relative)
+    {
+        return estimate.error <= relative * std::fabs(estimate.value);
+    }
+
+    /*******************************************************************/
+    /*** Measurement stride and stopping rule for one temperature.   ***/
+    /*** tick() is called once per sweep (or cluster step) after     ***/
+    /*** thermalisation and says whether to measure; record() takes  ***/
+    /*** the measured value of the slowest observable. Whenever the  ***/
+    /*** measured series still has tau_int > 1 (in measurements),    ***/
+    /*** the stride doubles and the estimate restarts, so the stride ***/
+    /*** settles at about 2 tau_int sweeps: 1 far from T_c, longer   ***/
+    /*** near it. check() is true at the end of every window of      ***/
+    /*** check_every measurements that kept the stride (tau_int <= 1 ***/
+    /*** in measurements); the driver then stops once its errors are ***/
+    /*** within target, never on the window that doubled the stride. ***/
+    /*******************************************************************/
+    class RunController
+    {
+    public:
+        explicit RunController(const long int check_every = 1024) : check_every(check_every) {}
+
+        bool tick()
+        {
+            if (--countdown > 0)
+            {
+                return false;
+            }
+            countdown = stride;
+            return true;
+        }
+
+        void record(const double x)
+        {
+            nmeasure++;
+            series.add(x);
+            if (series.count() % check_every == 0)
+            {
+                // a window that still has tau_int > 1 doubles the stride, and the next window has to prove it
+                settled = series.autocorrelation_time() <= 1e0;
+                if (!settled)
+                {
+                    stride *= 2;
+                    series = Binning();
+                }
+            }
+        }
+
+        // only at the end of a window of check_every measurements with tau_int <= 1
+        bool check() const { return settled && nmeasure % check_every == 0; }
+
+        long int get_stride() const { return stride; }
+        long int measurements() const { return nmeasure; }
+        // in sweeps (or cluster steps)
+        double autocorrelation_time() const { return stride * series.autocorrelation_time(); }
+
+        template <class Archive>
+        void checkpoint(Archive &archive)
+        {
+            archive(check_every);
+            archive(stride);
+            archive(countdown);
+            archive(nmeasure);
+            archive(settled);
+            archive(series);
+        }
+
+    private:
+        long int check_every;
+        long int stride = 1;
+        long int countdown = 1;
+        long int nmeasure = 0;
+        bool settled = false;
+        Binning series;
+    };
+
+    /*******************************************************************/
+    /*** Burn-in detection by MSER truncation. tick() is called once ***/
+    /*** per sweep and is true every spacing sweeps; add() then      ***/
+    /*** takes the value (energy, |M|, ...) of that sweep, so an     ***/
+    /*** O(N) measurement need not cost a sweep's worth every sweep. ***/
+    /*** At most nbatch batch means are kept, neighbours merging and ***/
+    /*** the batch doubling when full. After each batch it finds the ***/
+    /*** truncation point d minimising                               ***/
+    /***   sum_{k >= d} (b_k - mean_d)^2 / (m - d)^2                 ***/
+    /*** over the m batch means. Burn-in ends once d falls in the    ***/
+    /*** first quarter and the two halves of the series after d      ***/
+    /*** agree within 2 sigma. It never ends before max_burn_in / 10 ***/
+    /*** sweeps and always at max_burn_in, the old fixed cost.       ***/
+    /*******************************************************************/
+    class Equilibration
+    {
+    public:
+        // burn-in lasts between max_burn_in / 10 and max_burn_in sweeps, with a value every spacing sweeps
+        explicit Equilibration(const long int max_burn_in, const long int spacing = 1, const int nbatch = 64)
+            : spacing(spacing), max_count(std::max(max_burn_in / spacing, 1L)), min_count(max_count / 10), capacity(nbatch - nbatch % 2) {}
+
+        // true on the sweeps whose value add() wants
+        bool tick()
+        {
+            if (--countdown > 0)
+            {
+                return false;
+            }
+            countdown = spacing;
+            return true;
+        }
+
+        // true once burn-in is over
+        bool add(const double x)
+        {
+            if (done)
+            {
+                return true;
+            }
+            n++;
+            current += x;
+            if (++nfill == batch_size)
+            {
+                batch.push_back(current / batch_size);
+                current = 0e0;
+                nfill = 0;
+                if ((int)batch.size() == capacity)
+                {
+                    for (int b = 0; b != capacity / 2; b++)
+                    {
+                        batch[b] = 0.5 * (batch[2 * b] + batch[2 * b + 1]);
+                    }
+                    batch.resize(capacity / 2);
+                    batch_size *= 2;
+                }
+                done = n >= min_count && (int)batch.size() >= capacity / 2 && stationary();
+            }
+            done = done || n >= max_count;
+            return done;
+        }
+
+        bool equilibrated() const { return done; }
+        // sweeps before burn-in ended
+        long int burn_in() const { return n * spacing; }
+        long int get_spacing() const { return spacing; }
+
+        template <class Archive>
+        void checkpoint(Archive &archive)
+        {
+            archive(spacing);
+            archive(countdown);
+            archive(max_count);
+            archive(min_count);
+            archive(capacity);
+            archive(batch_size);
+            archive(n);
+            archive(nfill);
+            archive(current);
+            archive(batch);
+            archive(done);
+        }
+
+    private:
+        // MSER truncation point in the first quarter, and the two halves after it agree within 2 sigma
+        bool stationary() const
+        {
+            const int m = (int)batch.size();
+            const int d = truncation();
+            if (4 * d >= m)
+            {
+                return false;
+            }
+            const int half = (m - d) / 2;
+            Welford first, second;
+            for (int b = d; b != d + half; b++)
+            {
+                first.add(batch[b]);
+            }
+            for (int b = d + half; b != m; b++)
+            {
+                second.add(batch[b]);
+            }
+            // spread of the later half only: a drift inflates the earlier one
+            const double error = std::sqrt(second.variance() * (1e0 / first.count() + 1e0 / second.count()));
+            return std::fabs(first.mean() - second.mean()) <= 2e0 * error;
+        }
+
+        // MSER truncation point over the first three quarters of the batches
+        int truncation() const
+        {
+            const int m = (int)batch.size();
+            double sum = 0e0;
+            double sum2 = 0e0;
+            int best = m - 1;
+            double smallest = std::numeric_limits<double>::infinity();
+            for (int d = m - 1; d >= 0; d--)
+            {
+                sum += batch[d];
+                sum2 += batch[d] * batch[d];
+                const int k = m - d;
+                if (4 * d > 3 * m)
+                {
+                    continue;
+                }
+                const double statistic = (sum2 - sum * sum / k) / ((double)k * k);
+                if (statistic <= smallest)
+                {
+                    smallest = statistic;
+                    best = d;
+                }
+            }
+            return best;
+        }
+
+        long int spacing;
+        long int countdown = 1;
+        long int max_count; // values, not sweeps
+        long int min_count;
+        int capacity;
+        long int batch_size = 1;
+        long int n = 0;
+        long int nfill = 0;
+        double current = 0e0;
+        std::vector<double> batch;
+        bool done = false;
+    };
+}
+
+#endif
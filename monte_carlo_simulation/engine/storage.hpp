@@ -0,0 +1,129 @@
+#ifndef MCMC_STORAGE_HPP
+#define MCMC_STORAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace mcmc
+{
+    /*** std::allocator that hands out 64-byte (cache line) aligned blocks ***/
+    template <class T>
+    struct CacheAlignedAllocator
+    {
+        using value_type = T;
+        static constexpr std::size_t alignment = 64;
+
+        CacheAlignedAllocator() = default;
+        template <class U>
+        CacheAlignedAllocator(const CacheAlignedAllocator<U> &) {}
+
+        T *allocate(const std::size_t n) { return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(alignment))); }
+        void deallocate(T *p, const std::size_t) { ::operator delete(p, std::align_val_t(alignment)); }
+
+        template <class U>
+        bool operator==(const CacheAlignedAllocator<U> &) const { return true; }
+        template <class U>
+        bool operator!=(const CacheAlignedAllocator<U> &) const { return false; }
+    };
+
+    template <class T>
+    using aligned_vector = std::vector<T, CacheAlignedAllocator<T>>;
+
+    /*****************************************************************/
+    /*** Spin storage of a lattice: ncell states 0..Q-1 on the heap ***/
+    /***   IntStorage    : one int per cell                         ***/
+    /***   ByteStorage   : one uint8_t per cell                     ***/
+    /***   PackedStorage : 1, 2, 4 or 8 bits per cell in uint64_t   ***/
+    /*** IntStorage and ByteStorage expose data() for row kernels.  ***/
+    /*****************************************************************/
+    template <int Q>
+    class IntStorage
+    {
+    public:
+        using value_type = int;
+
+        explicit IntStorage(const int ncell) : spin(ncell, 0) {}
+
+        int get(const int c) const { return spin[c]; }
+        void set(const int c, const int state) { spin[c] = state; }
+        void fill(const int state)
+        {
+            for (int &s : spin)
+            {
+                s = state;
+            }
+        }
+
+        int *data() { return spin.data(); }
+        const int *data() const { return spin.data(); }
+
+    private:
+        aligned_vector<int> spin;
+    };
+
+    template <int Q>
+    class ByteStorage
+    {
+    public:
+        static_assert(Q <= 256, "ByteStorage holds at most 256 states");
+        using value_type = std::uint8_t;
+
+        explicit ByteStorage(const int ncell) : spin(ncell, 0) {}
+
+        int get(const int c) const { return spin[c]; }
+        void set(const int c, const int state) { spin[c] = (std::uint8_t)state; }
+        void fill(const int state)
+        {
+            for (std::uint8_t &s : spin)
+            {
+                s = (std::uint8_t)state;
+            }
+        }
+
+        std::uint8_t *data() { return spin.data(); }
+        const std::uint8_t *data() const { return spin.data(); }
+
+    private:
+        aligned_vector<std::uint8_t> spin;
+    };
+
+    template <int Q>
+    class PackedStorage
+    {
+    public:
+        static_assert(Q <= 256, "PackedStorage holds at most 256 states");
+        // smallest power-of-two width that holds Q states, so no cell straddles two words
+        static constexpr int nbit = Q <= 2 ? 1 : Q <= 4 ? 2 : Q <= 16 ? 4 : 8;
+        static constexpr int per_word = 64 / nbit;
+        static constexpr std::uint64_t mask = (1ULL << nbit) - 1;
+
+        explicit PackedStorage(const int ncell) : word((ncell + per_word - 1) / per_word, 0) {}
+
+        int get(const int c) const { return (int)((word[c / per_word] >> (c % per_word * nbit)) & mask); }
+        void set(const int c, const int state)
+        {
+            std::uint64_t &w = word[c / per_word];
+            const int shift = c % per_word * nbit;
+            w = (w & ~(mask << shift)) | ((std::uint64_t)state << shift);
+        }
+        void fill(const int state)
+        {
+            std::uint64_t pattern = 0;
+            for (int k = 0; k != per_word; k++)
+            {
+                pattern |= (std::uint64_t)state << (k * nbit);
+            }
+            for (std::uint64_t &w : word)
+            {
+                w = pattern;
+            }
+        }
+
+    private:
+        aligned_vector<std::uint64_t> word;
+    };
+}
+
+#endif
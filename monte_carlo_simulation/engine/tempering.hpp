@@ -0,0 +1,131 @@
+#ifndef MCMC_TEMPERING_HPP
+#define MCMC_TEMPERING_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "random.hpp"
+#include "observables.hpp"
+
+namespace mcmc
+{
+    /*******************************************************************/
+    /*** Parallel tempering (replica exchange) over a temperature    ***/
+    /*** grid T_0 < T_1 < ... : one replica per temperature, each    ***/
+    /*** with its own stream and RunningTotals. update() moves every ***/
+    /*** replica at its current temperature, one replica per OpenMP  ***/
+    /*** thread; exchange() proposes swaps of neighbouring           ***/
+    /*** temperatures, alternating even and odd pairs, accepted with ***/
+    /***   min(1, exp((1/T_t - 1/T_t+1) (E_t - E_t+1)))              ***/
+    /*** A swap exchanges temperature labels, not lattices.          ***/
+    /*** Without -fopenmp the replicas run one after another.        ***/
+    /*******************************************************************/
+    template <class Lattice, class Update, class Rng = Xoshiro256ss>
+    class ReplicaExchange
+    {
+    public:
+        using Model = typename Lattice::Model;
+
+        // make(T) builds the update for temperature T; replica r draws from stream r, the swaps from stream nreplica
+        template <class MakeUpdate>
+        ReplicaExchange(const std::vector<double> &temperature, const double coupling_J, const double coupling_h,
+                        const std::uint64_t seed, MakeUpdate make)
+            : coupling_J(coupling_J), coupling_h(coupling_h), nreplica((int)temperature.size()), spin(nreplica),
+              swap_rng(seed, nreplica), ntry(nreplica, 0), naccept(nreplica, 0)
+        {
+            for (int t = 0; t != nreplica; t++)
+            {
+                update.push_back(make(temperature[t]));
+                beta.push_back(1e0 / temperature[t]);
+                rng.emplace_back(seed, t);
+                slot.push_back(t);
+                replica.push_back(t);
+            }
+            rebuild();
+#ifdef _OPENMP
+            nthread = omp_get_max_threads();
+#endif
+            nthread = nthread < nreplica ? nthread : nreplica;
+        }
+
+        // call after changing configurations through lattice(r)
+        void rebuild()
+        {
+            totals.clear();
+            for (int r = 0; r != nreplica; r++)
+            {
+                totals.emplace_back(spin[r]);
+            }
+        }
+
+        // move(update, spin, rng, totals) for every replica, in parallel
+        template <class Move>
+        void update_all(Move move)
+        {
+#pragma omp parallel for schedule(static) num_threads(nthread)
+            for (int r = 0; r < nreplica; r++)
+            {
+                move(update[slot[r]], spin[r], rng[r], &totals[r]);
+            }
+        }
+
+        // one round of swap proposals between neighbouring temperatures
+        void exchange()
+        {
+            for (int t = parity; t + 1 < nreplica; t += 2)
+            {
+                const int a = replica[t];
+                const int b = replica[t + 1];
+                const double delta = (beta[t] - beta[t + 1]) * (energy(a) - energy(b));
+                ntry[t]++;
+                if (delta >= 0e0 || swap_rng.uniform() < std::exp(delta))
+                {
+                    naccept[t]++;
+                    replica[t] = b;
+                    replica[t + 1] = a;
+                    slot[a] = t + 1;
+                    slot[b] = t;
+                }
+            }
+            parity ^= 1;
+        }
+
+        int size() const { return nreplica; }
+        int get_num_threads() const { return nthread; }
+        double get_temperature(const int t) const { return 1e0 / beta[t]; }
+
+        // configuration and totals currently at temperature t
+        const Lattice &at(const int t) const { return spin[replica[t]]; }
+        const RunningTotals<Model> &totals_at(const int t) const { return totals[replica[t]]; }
+        // replica r, whatever its temperature (for initial configurations)
+        Lattice &lattice(const int r) { return spin[r]; }
+        const Rng &generator(const int r) const { return rng[r]; }
+
+        // fraction of accepted swaps between T_t and T_t+1
+        double acceptance(const int t) const { return ntry[t] ? naccept[t] / (double)ntry[t] : 0e0; }
+
+    private:
+        double energy(const int r) const { return totals[r].energy(coupling_J, coupling_h); }
+
+        double coupling_J;
+        double coupling_h;
+        int nreplica;
+        int nthread = 1;
+        int parity = 0;
+        std::vector<Lattice> spin;
+        std::vector<RunningTotals<Model>> totals;
+        std::vector<Update> update; // update[t] runs at temperature t
+        std::vector<double> beta;
+        std::vector<Rng> rng; // rng[r] belongs to replica r
+        Rng swap_rng;
+        std::vector<int> slot;    // temperature of replica r
+        std::vector<int> replica; // replica at temperature t
+        std::vector<long int> ntry;
+        std::vector<long int> naccept;
+    };
+}
+
+#endif
@@ -0,0 +1,547 @@
+#ifndef MCMC_UPDATES_HPP
+#define MCMC_UPDATES_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "acceptance.hpp"
+#include "observables.hpp"
+
+namespace mcmc
+{
+    /***********************************************/
+    /*** Single-site Metropolis update           ***/
+    /*** one step = one randomly chosen site     ***/
+    /*** acceptance from a per-temperature table ***/
+    /***********************************************/
+    template <class Lattice>
+    class Metropolis
+    {
+    public:
+        using Model = typename Lattice::Model;
+        using Field = LocalField<Model::Q>;
+
+        Metropolis(const double coupling_J, const double coupling_h, const double temperature)
+            : coupling_J(coupling_J), coupling_h(coupling_h)
+        {
+            set_temperature(temperature);
+        }
+
+        void set_temperature(const double T)
+        {
+            temperature = T;
+            table.build(coupling_J, coupling_h, temperature);
+        }
+        double get_temperature() const { return temperature; }
+
+        // change of the action when site i goes from its state to next_spin
+        double calc_action_change(const Lattice &spin, const int i, const int next_spin) const
+        {
+            int n[4];
+            spin.neighbour_states(i, n);
+            const int s = spin[i];
+            const double sum_change = Model::bond_change(s, next_spin, n);
+            const double site_change = Model::site(s) - Model::site(next_spin);
+            return (sum_change * coupling_J + site_change * coupling_h) / temperature;
+        }
+
+        // totals (optional) follow every accepted proposal
+        template <class Rng>
+        bool step(Lattice &spin, Rng &rng, RunningTotals<Model> *totals = nullptr) const
+        {
+            const int c = spin.cell(rng.below(Lattice::nsite));
+            const int s = spin.cell_state(c);
+            const int next_spin = Model::propose(s, rng);
+            int n[4];
+            spin.cell_neighbour_states(c, n);
+            if (accept(rng, table(Field::index(n), s, next_spin)))
+            {
+                // accept
+                spin.set_cell(c, next_spin);
+                if (totals)
+                {
+                    totals->change(s, next_spin, -Model::bond_change(s, next_spin, n));
+                }
+                return true;
+            }
+            // reject
+            return false;
+        }
+
+        // nsite single-site steps; returns the number of accepted proposals
+        template <class Rng>
+        long int sweep(Lattice &spin, Rng &rng, RunningTotals<Model> *totals = nullptr) const
+        {
+            long int naccept = 0;
+            for (int k = 0; k != Lattice::nsite; k++)
+            {
+                naccept += step(spin, rng, totals);
+            }
+            return naccept;
+        }
+
+    private:
+        double coupling_J;
+        double coupling_h;
+        double temperature = 1e0;
+        MetropolisTable<Model> table;
+    };
+
+    /*******************************************************/
+    /*** Single-site heat-bath update                    ***/
+    /*** the new state is drawn from exp(-E_a/T) / Z_loc ***/
+    /*** through a per-temperature cumulative table      ***/
+    /*******************************************************/
+    template <class Lattice>
+    class HeatBath
+    {
+    public:
+        using Model = typename Lattice::Model;
+        using Field = LocalField<Model::Q>;
+        static constexpr int Q = Model::Q;
+
+        HeatBath(const double coupling_J, const double coupling_h, const double temperature)
+            : coupling_J(coupling_J), coupling_h(coupling_h)
+        {
+            set_temperature(temperature);
+        }
+
+        void set_temperature(const double T)
+        {
+            temperature = T;
+            table.build(coupling_J, coupling_h, temperature);
+        }
+        double get_temperature() const { return temperature; }
+
+        // totals (optional) follow the new state
+        template <class Rng>
+        void step(Lattice &spin, Rng &rng, RunningTotals<Model> *totals = nullptr) const
+        {
+            const int c = spin.cell(rng.below(Lattice::nsite));
+            int n[4];
+            spin.cell_neighbour_states(c, n);
+            const std::int32_t *cumulative = table[Field::index(n)];
+            const std::int32_t r = (std::int32_t)(rng.next_u32() >> 1);
+            int a = 0;
+            while (r > cumulative[a])
+            {
+                a++;
+            }
+            if (totals)
+            {
+                const int s = spin.cell_state(c);
+                totals->change(s, a, -Model::bond_change(s, a, n));
+            }
+            spin.set_cell(c, a);
+        }
+
+        template <class Rng>
+        void sweep(Lattice &spin, Rng &rng, RunningTotals<Model> *totals = nullptr) const
+        {
+            for (int k = 0; k != Lattice::nsite; k++)
+            {
+                step(spin, rng, totals);
+            }
+        }
+
+    private:
+        double coupling_J;
+        double coupling_h;
+        double temperature = 1e0;
+        HeatBathTable<Model> table;
+    };
+
+    /***************************************************/
+    /*** Wolff single-cluster update (h = 0 only)    ***/
+    /*** Cells are stamped with the cluster number   ***/
+    /*** (epoch) instead of clearing a mark array,   ***/
+    /*** and flipped as they join the cluster, so a  ***/
+    /*** step costs O(cluster size), not O(N).       ***/
+    /***************************************************/
+    template <class Lattice>
+    class Wolff
+    {
+    public:
+        using Model = typename Lattice::Model;
+
+        Wolff(const double coupling_J, const double temperature)
+            : coupling_J(coupling_J), temperature(temperature),
+              i_cluster(Lattice::nsite), visited(Lattice::ncell, 0)
+        {
+            set_temperature(temperature);
+        }
+
+        void set_temperature(const double T)
+        {
+            temperature = T;
+            threshold = acceptance_threshold(1e0 - std::exp(-Model::wolff_bond * coupling_J / temperature));
+        }
+        double get_temperature() const { return temperature; }
+
+        // grows a cluster from a random seed and flips it; returns the cluster size.
+        // totals (optional) get the cluster and the change of the boundary bonds
+        template <class Rng>
+        int step(Lattice &spin, Rng &rng, RunningTotals<Model> *totals = nullptr)
+        {
+            next_epoch();
+            int c = spin.cell(rng.below(Lattice::nsite));
+            const int spin_cluster = spin.cell_state(c);
+            const int next_spin = Model::cluster_state(spin_cluster, rng);
+            visited[c] = epoch;
+            spin.set_cell(c, next_spin);
+            i_cluster[0] = c;
+            n_cluster = 1;
+            for (int k = 0; k != n_cluster; k++)
+            {
+                int neighbour[4];
+                spin.neighbour_cells(i_cluster[k], neighbour);
+                for (int j : neighbour)
+                {
+                    if (visited[j] != epoch && spin.cell_state(j) == spin_cluster && accept(rng, threshold))
+                    {
+                        visited[j] = epoch;
+                        spin.set_cell(j, next_spin);
+                        i_cluster[n_cluster] = j;
+                        n_cluster = n_cluster + 1;
+                    }
+                }
+            }
+            if (totals)
+            {
+                double bond_change = 0e0;
+                for (int k = 0; k != n_cluster; k++)
+                {
+                    int neighbour[4];
+                    spin.neighbour_cells(i_cluster[k], neighbour);
+                    for (int j : neighbour)
+                    {
+                        if (visited[j] != epoch)
+                        {
+                            const int s = spin.cell_state(j);
+                            bond_change += Model::bond(next_spin, s) - Model::bond(spin_cluster, s);
+                        }
+                    }
+                }
+                totals->move(spin_cluster, next_spin, n_cluster, bond_change);
+            }
+            return n_cluster;
+        }
+
+        int cluster_size() const { return n_cluster; }
+        // storage cells (Lattice::cell) of the last cluster
+        const int *cluster() const { return i_cluster.data(); }
+
+    private:
+        // the marks are cleared only when the 32-bit cluster counter wraps
+        void next_epoch()
+        {
+            epoch = epoch + 1;
+            if (epoch == 0)
+            {
+                std::fill(visited.begin(), visited.end(), 0);
+                epoch = 1;
+            }
+        }
+
+        double coupling_J;
+        double temperature;
+        std::int32_t threshold = 0;
+        int n_cluster = 0;
+        std::uint32_t epoch = 0;
+        std::vector<int> i_cluster;         // flat stack of cluster cells, reused by every step
+        std::vector<std::uint32_t> visited; // visited[c] == epoch -> c is in the current cluster
+    };
+
+    /*****************************************************************/
+    /*** Wolff reflection-cluster update for the Clock model        ***/
+    /*** (h = 0 only). Every step mirrors a cluster about one of    ***/
+    /*** the Q symmetry axes, a -> (m - a) mod Q with random m.     ***/
+    /*** A neighbour in state b joins a cell that was in state a    ***/
+    /*** with 1 - exp(-J (bond(a,b) - bond(a,(m-b) mod Q)) / T)     ***/
+    /*** (0 if negative), read from a Q x Q x Q threshold table.    ***/
+    /*** Marks and stack work as in Wolff.                          ***/
+    /*****************************************************************/
+    template <class Lattice>
+    class ReflectionWolff
+    {
+    public:
+        using Model = typename Lattice::Model;
+        static constexpr int Q = Model::Q;
+
+        ReflectionWolff(const double coupling_J, const double temperature)
+            : coupling_J(coupling_J), temperature(temperature),
+              threshold(Q * Q * Q), i_cluster(Lattice::nsite), visited(Lattice::ncell, 0)
+        {
+            set_temperature(temperature);
+        }
+
+        void set_temperature(const double T)
+        {
+            temperature = T;
+            for (int m = 0; m != Q; m++)
+            {
+                for (int a = 0; a != Q; a++)
+                {
+                    for (int b = 0; b != Q; b++)
+                    {
+                        // cos() round-off leaves |bond_change| ~ 1e-16 where it is exactly 0
+                        const double bond_change = Model::bond(a, b) - Model::bond(a, reflect(m, b));
+                        threshold[(m * Q + a) * Q + b] = bond_change > 1e-12 ? acceptance_threshold(1e0 - std::exp(-coupling_J * bond_change / temperature)) : -1;
+                    }
+                }
+            }
+        }
+        double get_temperature() const { return temperature; }
+
+        // grows a cluster from a random seed and mirrors it; returns the cluster size.
+        // totals (optional) get every mirrored cell and its bonds leaving the cluster
+        template <class Rng>
+        int step(Lattice &spin, Rng &rng, RunningTotals<Model> *totals = nullptr)
+        {
+            next_epoch();
+            const int m = rng.below(Q);
+            const std::int32_t *table = threshold.data() + m * Q * Q;
+            int c = spin.cell(rng.below(Lattice::nsite));
+            visited[c] = epoch;
+            spin.set_cell(c, reflect(m, spin.cell_state(c)));
+            i_cluster[0] = c;
+            n_cluster = 1;
+            for (int k = 0; k != n_cluster; k++)
+            {
+                c = i_cluster[k];
+                const std::int32_t *row = table + reflect(m, spin.cell_state(c)) * Q; // state before the flip
+                int neighbour[4];
+                spin.neighbour_cells(c, neighbour);
+                for (int j : neighbour)
+                {
+                    if (visited[j] == epoch)
+                    {
+                        continue;
+                    }
+                    const int b = spin.cell_state(j);
+                    if (row[b] >= 0 && accept(rng, row[b]))
+                    {
+                        visited[j] = epoch;
+                        spin.set_cell(j, reflect(m, b));
+                        i_cluster[n_cluster] = j;
+                        n_cluster = n_cluster + 1;
+                    }
+                }
+            }
+            if (totals)
+            {
+                // bonds inside the cluster keep their energy under the reflection
+                for (int k = 0; k != n_cluster; k++)
+                {
+                    const int a = spin.cell_state(i_cluster[k]);
+                    const int before = reflect(m, a);
+                    int neighbour[4];
+                    spin.neighbour_cells(i_cluster[k], neighbour);
+                    double bond_change = 0e0;
+                    for (int j : neighbour)
+                    {
+                        if (visited[j] != epoch)
+                        {
+                            const int s = spin.cell_state(j);
+                            bond_change += Model::bond(a, s) - Model::bond(before, s);
+                        }
+                    }
+                    totals->change(before, a, bond_change);
+                }
+            }
+            return n_cluster;
+        }
+
+        int cluster_size() const { return n_cluster; }
+        // storage cells (Lattice::cell) of the last cluster
+        const int *cluster() const { return i_cluster.data(); }
+
+    private:
+        static constexpr int reflect(const int m, const int a) { return (m - a + Q) % Q; }
+
+        void next_epoch()
+        {
+            epoch = epoch + 1;
+            if (epoch == 0)
+            {
+                std::fill(visited.begin(), visited.end(), 0);
+                epoch = 1;
+            }
+        }
+
+        double coupling_J;
+        double temperature;
+        std::vector<std::int32_t> threshold; // threshold[(m * Q + a) * Q + b], negative -> never
+        int n_cluster = 0;
+        std::uint32_t epoch = 0;
+        std::vector<int> i_cluster;
+        std::vector<std::uint32_t> visited;
+    };
+
+    /*****************************************************************/
+    /*** Swendsen-Wang multi-cluster update (h = 0 only)           ***/
+    /***   1. bonds between equal neighbours with probability      ***/
+    /***      1 - exp(-wolff_bond J / T), one pass over whole rows ***/
+    /***   2. clusters labelled by union-find on site indices      ***/
+    /***   3. every cluster takes a uniformly random new state     ***/
+    /*** Ising and Potts; needs IntStorage or ByteStorage.         ***/
+    /*****************************************************************/
+    template <class Lattice>
+    class SwendsenWang
+    {
+    public:
+        using Model = typename Lattice::Model;
+        static constexpr int Q = Model::Q;
+        static constexpr int L = Lattice::L;
+        static constexpr int nsite = Lattice::nsite;
+
+        SwendsenWang(const double coupling_J, const double temperature)
+            : coupling_J(coupling_J), temperature(temperature),
+              bond_x(nsite), bond_y(nsite), parent(nsite), new_state(nsite), random(2 * L)
+        {
+            set_temperature(temperature);
+        }
+
+        void set_temperature(const double T)
+        {
+            temperature = T;
+            threshold = acceptance_threshold(1e0 - std::exp(-Model::wolff_bond * coupling_J / temperature));
+        }
+        double get_temperature() const { return temperature; }
+
+        // one update of every cluster; returns the number of clusters.
+        // totals (optional) are rebuilt, which costs no more than the update itself
+        template <class Rng>
+        int step(Lattice &spin, Rng &rng, RunningTotals<Model> *totals = nullptr)
+        {
+            place_bonds(spin, rng);
+            label();
+            n_cluster = 0;
+            for (int i = 0; i != nsite; i++)
+            {
+                if (parent[i] == i)
+                {
+                    new_state[i] = rng.below(Q);
+                    n_cluster = n_cluster + 1;
+                }
+            }
+            for (int ix = 0; ix != L; ix++)
+            {
+                auto *s = spin.row(ix);
+                const int *root = parent.data() + ix * L;
+                for (int iy = 0; iy != L; iy++)
+                {
+                    s[iy] = new_state[root[iy]];
+                }
+            }
+            spin.refresh();
+            if (totals)
+            {
+                totals->rebuild(spin);
+            }
+            return n_cluster;
+        }
+
+        template <class Rng>
+        void sweep(Lattice &spin, Rng &rng, RunningTotals<Model> *totals = nullptr)
+        {
+            step(spin, rng, totals);
+        }
+
+        int cluster_count() const { return n_cluster; }
+        // root site of every site after the last step
+        const int *labels() const { return parent.data(); }
+
+    private:
+        // bond_x[i]: i -- i + x; bond_y[i]: i -- i + y
+        template <class Rng>
+        void place_bonds(const Lattice &spin, Rng &rng)
+        {
+            const std::uint32_t *r = random.data();
+            for (int ix = 0; ix != L; ix++)
+            {
+                const auto *s = spin.row(ix);
+                const auto *down = spin.row(ix + 1 == L ? 0 : ix + 1);
+                std::uint8_t *bx = bond_x.data() + ix * L;
+                std::uint8_t *by = bond_y.data() + ix * L;
+                rng.fill(random.data(), 2 * L);
+                for (int iy = 0; iy != L; iy++)
+                {
+                    bx[iy] = (s[iy] == down[iy]) & ((std::int32_t)(r[iy] >> 1) <= threshold);
+                }
+                for (int iy = 0; iy != L - 1; iy++)
+                {
+                    by[iy] = (s[iy] == s[iy + 1]) & ((std::int32_t)(r[L + iy] >> 1) <= threshold);
+                }
+                by[L - 1] = (s[L - 1] == s[0]) & ((std::int32_t)(r[2 * L - 1] >> 1) <= threshold);
+            }
+        }
+
+        // afterwards parent[i] is the root of i, the smallest site of its cluster
+        void label()
+        {
+            for (int i = 0; i != nsite; i++)
+            {
+                parent[i] = i;
+            }
+            for (int ix = 0; ix != L; ix++)
+            {
+                const int down = (ix + 1 == L ? 0 : ix + 1) * L;
+                for (int iy = 0; iy != L; iy++)
+                {
+                    const int i = ix * L + iy;
+                    if (bond_x[i])
+                    {
+                        unite(i, down + iy);
+                    }
+                    if (bond_y[i])
+                    {
+                        unite(i, ix * L + (iy + 1 == L ? 0 : iy + 1));
+                    }
+                }
+            }
+            // roots are the smallest index of their tree, so one forward pass flattens every tree
+            for (int i = 0; i != nsite; i++)
+            {
+                parent[i] = parent[parent[i]];
+            }
+        }
+
+        int find(int i)
+        {
+            while (parent[i] != i)
+            {
+                parent[i] = parent[parent[i]]; // path halving
+                i = parent[i];
+            }
+            return i;
+        }
+
+        void unite(const int i, const int j)
+        {
+            const int a = find(i);
+            const int b = find(j);
+            if (a < b)
+            {
+                parent[b] = a;
+            }
+            else if (b < a)
+            {
+                parent[a] = b;
+            }
+        }
+
+        double coupling_J;
+        double temperature;
+        std::int32_t threshold = 0;
+        int n_cluster = 0;
+        std::vector<std::uint8_t> bond_x;
+        std::vector<std::uint8_t> bond_y;
+        std::vector<int> parent;
+        std::vector<int> new_state; // new state of each cluster, indexed by its root
+        std::vector<std::uint32_t> random;
+    };
+}
+
+#endif
@@ -5,27 +5,26 @@
 
 using namespace std;
 
+mt19937 &get_engine()
+{
+    /***** 乱数エンジン: スレッドごとに一度だけ seed する *****/
+    thread_local random_device seed;
+    thread_local mt19937 engine(seed()); // メルセンヌ・ツイスター法
+    // thread_local std::minstd_rand0 engine(seed());    // 線形合同法
+    // thread_local std::ranlux24_base engine(seed());   // キャリー付き減算法
+    return engine;
+}
+
 double get_uniform_distributed_rand(double min_val, double max_val)
 {
     /***** 一様乱数生成 *****/
-    random_device seed;
-    mt19937 engine(seed()); // メルセンヌ・ツイスター法
-    // std::minstd_rand0 engine(seed());    // 線形合同法
-    // std::ranlux24_base engine(seed());   // キャリー付き減算法
-
     uniform_real_distribution<double> get_rand(min_val, max_val);
-
-    return get_rand(engine);
+    return get_rand(get_engine());
 }
 
 double get_normal_distributed_rand(double mu, double sigma)
 {
     /***** 一次元正規乱数生成 *****/
-    random_device seed;
-    mt19937 engine(seed()); // メルセンヌ・ツイスター法
-    // std::minstd_rand0 engine(seed());    // 線形合同法
-    // std::ranlux24_base engine(seed());   // キャリー付き減算法
-
     normal_distribution<double> get_rand(mu, sigma);
-    return get_rand(engine);
+    return get_rand(get_engine());
 }